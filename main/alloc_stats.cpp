@@ -0,0 +1,36 @@
+#include "alloc_stats.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stddef.h>
+
+static TaskHandle_t s_watched_task;
+static volatile uint32_t s_alloc_count;
+
+void alloc_stats_watch_current_task(void)
+{
+	s_watched_task = xTaskGetCurrentTaskHandle();
+#if !CONFIG_HEAP_USE_HOOKS
+	ESP_LOGI(__func__, "Heap allocations are not counted, build with sdkconfig.heap_debug to check them");
+#endif
+}
+
+uint32_t alloc_stats_count(void)
+{
+	return s_alloc_count;
+}
+
+#if CONFIG_HEAP_USE_HOOKS
+/* Called by the heap component on every successful allocation, possibly from an ISR */
+extern "C" IRAM_ATTR void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+	if (s_watched_task != NULL && xTaskGetCurrentTaskHandle() == s_watched_task) {
+		s_alloc_count = s_alloc_count + 1;
+	}
+}
+
+extern "C" IRAM_ATTR void esp_heap_trace_free_hook(void *ptr)
+{
+}
+#endif
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Heap allocation counter for one task, fed by the heap hooks (CONFIG_HEAP_USE_HOOKS, enabled by the
+ * sdkconfig.heap_debug fragment). Without the hooks the counter stays at zero. */
+void alloc_stats_watch_current_task(void);
+uint32_t alloc_stats_count(void);
@@ -0,0 +1,23 @@
+#include <esp_matter.h>
+
+#include <app_priv.h>
+#include <app_drivers.h>
+#include APP_SKU_MANIFEST
+
+using namespace esp_matter;
+using namespace esp_matter::attribute;
+
+// This callback is called for every attribute update. The callback implementation shall
+// handle the desired attributes and return an appropriate error code. If the attribute
+// is not of your interest, please do not return an error code and strictly return ESP_OK.
+esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
+				  uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+{
+	esp_err_t err = ESP_OK;
+
+	if (type == PRE_UPDATE) {
+		err = manifest::device_attribute_update(k_device, endpoint_id, cluster_id, attribute_id, val, priv_data);
+	}
+
+	return err;
+}
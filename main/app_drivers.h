@@ -0,0 +1,59 @@
+#pragma once
+
+/* Driver entry points and their manifest bindings, one endpoint_init(), endpoint_start() and
+ * endpoint_attribute_update() overload per endpoint kind in device_manifest.h */
+
+#include <esp_err.h>
+#include <esp_matter.h>
+#include <stdint.h>
+
+#include "device_manifest.h"
+
+extern uint16_t light_endpoint_id;
+
+esp_err_t led_driver_attribute_update(void *matter_handle, uint16_t endpoint_id, uint32_t cluster_id,
+				      uint32_t attribute_id, esp_matter_attr_val_t *val);
+
+esp_err_t led_driver_set_defaults(uint16_t endpoint_id);
+
+int matter_board_led_init(esp_matter::node_t *node, const manifest::color_light *config);
+int matter_temp_init(esp_matter::node_t *node, const manifest::temp_probes *config);
+
+namespace manifest {
+
+inline esp_err_t endpoint_init(esp_matter::node_t *node, const color_light &ep)
+{
+	return matter_board_led_init(node, &ep);
+}
+
+inline esp_err_t endpoint_start(const color_light &ep)
+{
+	return led_driver_set_defaults(light_endpoint_id);
+}
+
+inline esp_err_t endpoint_attribute_update(const color_light &ep, uint16_t endpoint_id, uint32_t cluster_id,
+					   uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+{
+	if (endpoint_id != light_endpoint_id) {
+		return ESP_OK;
+	}
+	return led_driver_attribute_update(priv_data, endpoint_id, cluster_id, attribute_id, val);
+}
+
+inline esp_err_t endpoint_init(esp_matter::node_t *node, const temp_probes &ep)
+{
+	return matter_temp_init(node, &ep);
+}
+
+inline esp_err_t endpoint_start(const temp_probes &ep)
+{
+	return ESP_OK;
+}
+
+inline esp_err_t endpoint_attribute_update(const temp_probes &ep, uint16_t endpoint_id, uint32_t cluster_id,
+					   uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+{
+	return ESP_OK;
+}
+
+} // namespace manifest
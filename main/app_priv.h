@@ -34,14 +34,11 @@
 #define DEFAULT_HUE 128
 #define DEFAULT_SATURATION 254
 
-esp_err_t led_driver_attribute_update(void *matter_handle, uint16_t endpoint_id, uint32_t cluster_id,
-                                      uint32_t attribute_id, esp_matter_attr_val_t *val);
-
-esp_err_t led_driver_set_defaults(uint16_t endpoint_id);
+/** Default temperature probe policy, in centi-degrees */
+#define DEFAULT_TEMP_DEADBAND 50
+#define DEFAULT_TEMP_GUARD 100
 
 using namespace esp_matter;
-int matter_board_led_init(node_t *node);
-int matter_temp_init(node_t *node, int gpio_pin);
 
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD
 #define ESP_OPENTHREAD_DEFAULT_RADIO_CONFIG()                                           \
@@ -59,3 +56,7 @@ int matter_temp_init(node_t *node, int gpio_pin);
         .storage_partition_name = "nvs", .netif_queue_size = 10, .task_queue_size = 10, \
     }
 #endif
+
+/** Attribute update callback of the node: hands PRE_UPDATE writes to the manifest's endpoint drivers */
+esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
+				  uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data);
@@ -0,0 +1,90 @@
+#include "attr_cache.h"
+#include "esp_log.h"
+#include "esp_matter_attribute_utils.h"
+#include "esp_matter_core.h"
+#include <app/reporting/reporting.h>
+
+using namespace esp_matter;
+
+static bool attr_val_equal(const esp_matter_attr_val_t *a, const esp_matter_attr_val_t *b)
+{
+	if (a->type != b->type) {
+		return false;
+	}
+	switch (a->type) {
+	case ESP_MATTER_VAL_TYPE_BOOLEAN:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_BOOLEAN:
+		return a->val.b == b->val.b;
+	case ESP_MATTER_VAL_TYPE_INTEGER:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_INTEGER:
+		return a->val.i == b->val.i;
+	case ESP_MATTER_VAL_TYPE_INT8:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_INT8:
+		return a->val.i8 == b->val.i8;
+	case ESP_MATTER_VAL_TYPE_UINT8:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_UINT8:
+	case ESP_MATTER_VAL_TYPE_ENUM8:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_ENUM8:
+	case ESP_MATTER_VAL_TYPE_BITMAP8:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_BITMAP8:
+		return a->val.u8 == b->val.u8;
+	case ESP_MATTER_VAL_TYPE_INT16:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_INT16:
+		return a->val.i16 == b->val.i16;
+	case ESP_MATTER_VAL_TYPE_UINT16:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_UINT16:
+	case ESP_MATTER_VAL_TYPE_BITMAP16:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_BITMAP16:
+		return a->val.u16 == b->val.u16;
+	case ESP_MATTER_VAL_TYPE_INT32:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_INT32:
+		return a->val.i32 == b->val.i32;
+	case ESP_MATTER_VAL_TYPE_UINT32:
+	case ESP_MATTER_VAL_TYPE_NULLABLE_UINT32:
+		return a->val.u32 == b->val.u32;
+	default:
+		/* strings, arrays and floats always count as changed */
+		return false;
+	}
+}
+
+esp_err_t attr_slot_bind(attr_slot *slot, uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id)
+{
+	attribute_t *attribute = attribute::get(endpoint_id, cluster_id, attribute_id);
+	if (attribute == nullptr) {
+		ESP_LOGE(__func__, "No attribute 0x%" PRIx32 " in cluster 0x%" PRIx32 " on endpoint %d", attribute_id,
+			 cluster_id, endpoint_id);
+		return ESP_ERR_NOT_FOUND;
+	}
+	*slot = {};
+	slot->attribute = attribute;
+	slot->endpoint_id = endpoint_id;
+	slot->cluster_id = cluster_id;
+	slot->attribute_id = attribute_id;
+	return ESP_OK;
+}
+
+esp_err_t attr_slot_push(attr_slot *slot, esp_matter_attr_val_t *val)
+{
+	if (slot->has_last && attr_val_equal(&slot->last, val)) {
+		return ESP_OK;
+	}
+
+	/* attribute::update() would look the attribute up again and calloc a scratch buffer for the raw value;
+	 * writing through the cached handle and flagging the path dirty for reporting avoids both. */
+	lock::status_t lock_status = lock::chip_stack_lock(portMAX_DELAY);
+	if (lock_status == lock::FAILED) {
+		ESP_LOGE(__func__, "Could not take the chip stack lock");
+		return ESP_FAIL;
+	}
+	esp_err_t err = attribute::set_val(slot->attribute, val);
+	if (err == ESP_OK) {
+		MatterReportingAttributeChangeCallback(slot->endpoint_id, slot->cluster_id, slot->attribute_id);
+		slot->last = *val;
+		slot->has_last = true;
+	}
+	if (lock_status == lock::SUCCESS) {
+		lock::chip_stack_unlock();
+	}
+	return err;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <esp_err.h>
+#include <esp_matter.h>
+
+/** An attribute resolved once at init, so periodic updates skip the endpoint/cluster/attribute lookup */
+struct attr_slot {
+	esp_matter::attribute_t *attribute;
+	uint16_t endpoint_id;
+	uint32_t cluster_id;
+	uint32_t attribute_id;
+	esp_matter_attr_val_t last;
+	bool has_last;
+};
+
+esp_err_t attr_slot_bind(attr_slot *slot, uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id);
+
+/* Stores and reports val, or does nothing if it equals the last pushed value. Never touches the heap. */
+esp_err_t attr_slot_push(attr_slot *slot, esp_matter_attr_val_t *val);
@@ -0,0 +1,99 @@
+#pragma once
+
+/* Compile-time device composition. A SKU is a single header under sku/ declaring one
+ * manifest::device<...> named k_device; device_init(), device_start() and device_attribute_update()
+ * expand over its endpoints at compile time, so drivers and clusters a SKU does not list are never
+ * referenced and get dropped by the linker. */
+
+#include <esp_err.h>
+#include <esp_matter.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <type_traits>
+
+#include "sensor_rules.h"
+#include "temp_policy.h"
+
+namespace manifest {
+
+struct attribute_ref {
+	uint32_t cluster_id;
+	uint32_t attribute_id;
+};
+
+/** Extended color light driven by the board LED */
+struct color_light {
+	bool on_off;
+	uint8_t level;
+	uint8_t color_mode;
+	/* attributes that change rapidly and are persisted lazily */
+	const attribute_ref *deferred;
+	size_t nr_deferred;
+};
+
+/** Policy of one DS18B20, by its ROM address as logged when it is attached */
+struct temp_probe_policy {
+	uint64_t address;
+	temp_policy policy;
+};
+
+/** One temperature sensor endpoint per DS18B20 found on a 1-Wire bus */
+struct temp_probes {
+	int gpio;
+	/* thresholds left empty are taken from the ABOVE/BELOW rules */
+	temp_policy policy;
+	/* probes that need another deadband or guard than policy, at most TEMP_BUS_MAX_PROBES */
+	const temp_probe_policy *probe_policies;
+	size_t nr_probe_policies;
+	/* alarm rules evaluated on each probe, raised through a BooleanState cluster */
+	const sensor_rule *rules;
+	size_t nr_rules;
+};
+
+template <typename... Endpoints> struct device {
+	/* the LED driver keeps a single light_endpoint_id */
+	static_assert((0 + ... + std::is_same_v<Endpoints, color_light>) <= 1, "at most one color_light per device");
+
+	std::tuple<Endpoints...> endpoints;
+
+	constexpr device(Endpoints... eps) : endpoints(eps...) {}
+};
+
+/* Driver binding: every endpoint kind provides endpoint_init(), endpoint_start() and
+ * endpoint_attribute_update() in app_drivers.h, found by argument dependent lookup when the folds below
+ * are instantiated */
+
+/* comma folds, so endpoints come up in manifest order and get their endpoint ids in that order; the
+ * first failing endpoint stops the fold and its error is returned */
+template <typename... Endpoints> esp_err_t device_init(esp_matter::node_t *node, const device<Endpoints...> &dev)
+{
+	esp_err_t err = ESP_OK;
+	std::apply([&](const auto &...ep) { ((err == ESP_OK ? err = endpoint_init(node, ep) : err), ...); }, dev.endpoints);
+	return err;
+}
+
+template <typename... Endpoints> esp_err_t device_start(const device<Endpoints...> &dev)
+{
+	esp_err_t err = ESP_OK;
+	std::apply([&](const auto &...ep) { ((err == ESP_OK ? err = endpoint_start(ep) : err), ...); }, dev.endpoints);
+	return err;
+}
+
+template <typename... Endpoints>
+esp_err_t device_attribute_update(const device<Endpoints...> &dev, uint16_t endpoint_id, uint32_t cluster_id,
+				  uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
+{
+	esp_err_t err = ESP_OK;
+	std::apply(
+	    [&](const auto &...ep) {
+		    ((err == ESP_OK ? err = endpoint_attribute_update(ep, endpoint_id, cluster_id, attribute_id, val,
+									     priv_data)
+				    : err),
+		     ...);
+	    },
+	    dev.endpoints);
+	return err;
+}
+
+} // namespace manifest
@@ -0,0 +1,177 @@
+#include "diag_log.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+#include "freertos/task.h"
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define DIAG_LOG_LINE_MAX 192
+#define DIAG_LOG_DRAIN_CHUNK 256
+#define DIAG_LOG_TASK_STACK 3072
+
+static StaticRingbuffer_t s_ring_struct;
+static uint8_t s_ring_storage[DIAG_LOG_RING_SIZE];
+static RingbufHandle_t s_ring;
+static FILE *s_stream;
+static vprintf_like_t s_console_vprintf = vprintf;
+/* start-up output (onboarding codes included) is far beyond the budget: it stays synchronous */
+static volatile bool s_async;
+
+static portMUX_TYPE s_budget_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_budget_us;
+static int32_t s_budget_bytes = DIAG_LOG_BURST_BYTES;
+static uint32_t s_dropped;
+
+static bool diag_log_take_budget(size_t len)
+{
+	bool ok;
+	int64_t now_us = esp_timer_get_time();
+	portENTER_CRITICAL_SAFE(&s_budget_lock);
+	int64_t refill = (now_us - s_budget_us) * DIAG_LOG_RATE_BYTES_PER_SEC / 1000000;
+	if (refill > 0) {
+		s_budget_bytes = refill + s_budget_bytes > DIAG_LOG_BURST_BYTES ? DIAG_LOG_BURST_BYTES
+										 : s_budget_bytes + refill;
+		s_budget_us = now_us;
+	}
+	ok = s_budget_bytes >= (int32_t)len;
+	if (ok) {
+		s_budget_bytes -= len;
+	}
+	portEXIT_CRITICAL_SAFE(&s_budget_lock);
+	return ok;
+}
+
+static void diag_log_put(const void *data, size_t len, bool rate_limited)
+{
+	if ((rate_limited && !diag_log_take_budget(len)) || xRingbufferSend(s_ring, data, len, 0) != pdTRUE) {
+		portENTER_CRITICAL_SAFE(&s_budget_lock);
+		s_dropped++;
+		portEXIT_CRITICAL_SAFE(&s_budget_lock);
+	}
+}
+
+/* "E (", after the color escape when CONFIG_LOG_COLORS is set */
+static bool diag_log_is_error(const char *line)
+{
+	if (line[0] == '\033') {
+		const char *end = strchr(line, 'm');
+		line = end ? end + 1 : line;
+	}
+	return strncmp(line, "E (", 3) == 0;
+}
+
+static int diag_log_vprintf(const char *fmt, va_list args)
+{
+	if (!s_async) {
+		return s_console_vprintf(fmt, args);
+	}
+	char line[DIAG_LOG_LINE_MAX];
+	va_list console_args;
+	va_copy(console_args, args);
+	int len = vsnprintf(line, sizeof(line), fmt, args);
+	if (len > 0 && diag_log_is_error(line)) {
+		/* errors are often followed by abort(): print them right away, ahead of the queued lines */
+		len = s_console_vprintf(fmt, console_args);
+		va_end(console_args);
+		return len;
+	}
+	va_end(console_args);
+	if (len <= 0) {
+		return len;
+	}
+	if (len >= (int)sizeof(line)) {
+		len = sizeof(line) - 1;
+		line[len - 1] = '\n';
+	}
+	diag_log_put(line, len, true);
+	return len;
+}
+
+static ssize_t diag_log_stream_write(void *cookie, const char *buf, size_t size)
+{
+	/* explicit dumps were asked for: only bounded by ring space */
+	diag_log_put(buf, size, false);
+	return size;
+}
+
+static void diag_log_drain(void *arg)
+{
+	uint32_t reported = 0;
+	for (;;) {
+		size_t size = 0;
+		void *data = xRingbufferReceiveUpTo(s_ring, &size, portMAX_DELAY, DIAG_LOG_DRAIN_CHUNK);
+		if (data == NULL) {
+			continue;
+		}
+		fwrite(data, 1, size, stdout);
+		vRingbufferReturnItem(s_ring, data);
+
+		portENTER_CRITICAL(&s_budget_lock);
+		uint32_t dropped = s_dropped;
+		portEXIT_CRITICAL(&s_budget_lock);
+		if (dropped != reported) {
+			fprintf(stdout, "[diag] %" PRIu32 " message(s) dropped\n", dropped - reported);
+			reported = dropped;
+		}
+		fflush(stdout);
+	}
+}
+
+esp_err_t diag_log_init(void)
+{
+	s_ring = xRingbufferCreateStatic(sizeof(s_ring_storage), RINGBUF_TYPE_BYTEBUF, s_ring_storage,
+					 &s_ring_struct);
+	if (s_ring == NULL) {
+		return ESP_FAIL;
+	}
+	cookie_io_functions_t stream_io = {
+	    .write = diag_log_stream_write,
+	};
+	s_stream = fopencookie(NULL, "w", stream_io);
+	if (s_stream == NULL) {
+		return ESP_ERR_NO_MEM;
+	}
+	setvbuf(s_stream, NULL, _IOLBF, 0);
+
+	if (xTaskCreate(diag_log_drain, "diag_log", DIAG_LOG_TASK_STACK, NULL, tskIDLE_PRIORITY + 1, NULL) !=
+	    pdPASS) {
+		return ESP_ERR_NO_MEM;
+	}
+	s_console_vprintf = esp_log_set_vprintf(diag_log_vprintf);
+	return ESP_OK;
+}
+
+void diag_log_start_async(void)
+{
+	s_async = s_ring != NULL;
+}
+
+void diag_trace(diag_trace_id id, uint32_t a, uint32_t b)
+{
+	struct __attribute__((packed)) {
+		uint32_t time_ms;
+		uint16_t id;
+		uint32_t a;
+		uint32_t b;
+	} record = {(uint32_t)(esp_timer_get_time() / 1000), (uint16_t)id, a, b};
+
+	static const char hex[] = "0123456789abcdef";
+	char line[2 + 2 * sizeof(record) + 1];
+	const uint8_t *raw = (const uint8_t *)&record;
+	line[0] = '#';
+	line[1] = 'T';
+	for (size_t i = 0; i < sizeof(record); i++) {
+		line[2 + 2 * i] = hex[raw[i] >> 4];
+		line[3 + 2 * i] = hex[raw[i] & 0xF];
+	}
+	line[sizeof(line) - 1] = '\n';
+	diag_log_put(line, sizeof(line), true);
+}
+
+FILE *diag_log_stream(void)
+{
+	return s_stream ? s_stream : stdout;
+}
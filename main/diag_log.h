@@ -0,0 +1,30 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Non-blocking diagnostics. Once started, ESP_LOG output goes into a ring buffer that a low priority task drains to
+ * the console, so a slow UART never stalls the logging task; output beyond the rate limit or ring
+ * space is dropped and counted. Error level lines skip the ring and are printed synchronously. */
+
+#define DIAG_LOG_RING_SIZE 4096
+/* sustained console budget, well below what a 115200 baud UART drains */
+#define DIAG_LOG_RATE_BYTES_PER_SEC 2048
+#define DIAG_LOG_BURST_BYTES 2048
+
+/** Trace ids, keep in sync with tools/diag_decode.py */
+enum diag_trace_id {
+	DIAG_TRACE_TEMP_READING = 1,	/* a: probe slot, b: centi-degrees */
+};
+
+esp_err_t diag_log_init(void);
+/* Until this is called ESP_LOG output is printed synchronously, so the start-up log and the onboarding
+ * codes are never dropped; call it once the Matter server is up */
+void diag_log_start_async(void);
+
+/* Compact trace record, printed as "#T" + hex and decoded on the host by tools/diag_decode.py */
+void diag_trace(diag_trace_id id, uint32_t a, uint32_t b);
+
+/* stdio stream into the ring buffer, for esp_pm_dump_locks() and friends */
+FILE *diag_log_stream(void);
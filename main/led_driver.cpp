@@ -14,14 +14,13 @@
 #include <bsp/esp_bsp_devkit.h>
 
 #include <app_priv.h>
+#include <app_drivers.h>
 
 using namespace chip::app::Clusters;
 using namespace esp_matter;
 
 led_indicator_handle_t bsp_leds[BSP_LED_NUM];
 
-extern uint16_t light_endpoint_id;
-
 /* Do any conversions/remapping for the actual value here */
 static esp_err_t led_set_power(led_indicator_handle_t handle, esp_matter_attr_val_t *val)
 {
@@ -137,21 +136,20 @@ void led_driver_init()
 	ESP_ERROR_CHECK(led_indicator_start(bsp_leds[0], BSP_LED_OFF));
 }
 
-int matter_board_led_init(node_t *node)
+int matter_board_led_init(node_t *node, const manifest::color_light *config)
 {
 	using namespace esp_matter::endpoint;
 
 	led_driver_init();
 
 	extended_color_light::config_t light_config;
-	light_config.on_off.on_off = DEFAULT_POWER;
-	light_config.on_off.on_off = false;
+	light_config.on_off.on_off = config->on_off;
 	light_config.on_off.lighting.start_up_on_off = nullptr;
-	light_config.level_control.current_level = DEFAULT_BRIGHTNESS / 4;
-	light_config.level_control.on_level = DEFAULT_BRIGHTNESS / 4;
-	light_config.level_control.lighting.start_up_current_level = DEFAULT_BRIGHTNESS / 4;
-	light_config.color_control.color_mode = (uint8_t)ColorControl::ColorMode::kColorTemperature;
-	light_config.color_control.enhanced_color_mode = (uint8_t)ColorControl::ColorMode::kColorTemperature;
+	light_config.level_control.current_level = config->level;
+	light_config.level_control.on_level = config->level;
+	light_config.level_control.lighting.start_up_current_level = config->level;
+	light_config.color_control.color_mode = config->color_mode;
+	light_config.color_control.enhanced_color_mode = config->color_mode;
 	light_config.color_control.color_temperature.startup_color_temperature_mireds = nullptr;
 
 	// endpoint handles can be used to add/modify clusters.
@@ -166,19 +164,11 @@ int matter_board_led_init(node_t *node)
 	ESP_LOGI(__func__, "Light created with endpoint_id %d", light_endpoint_id);
 
 	/* Mark deferred persistence for some attributes that might be changed rapidly */
-	attribute_t *current_level_attribute =
-	    attribute::get(light_endpoint_id, LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id);
-	attribute::set_deferred_persistence(current_level_attribute);
-
-	attribute_t *current_x_attribute =
-	    attribute::get(light_endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentX::Id);
-	attribute::set_deferred_persistence(current_x_attribute);
-	attribute_t *current_y_attribute =
-	    attribute::get(light_endpoint_id, ColorControl::Id, ColorControl::Attributes::CurrentY::Id);
-	attribute::set_deferred_persistence(current_y_attribute);
-	attribute_t *color_temp_attribute =
-	    attribute::get(light_endpoint_id, ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id);
-	attribute::set_deferred_persistence(color_temp_attribute);
+	for (size_t i = 0; i < config->nr_deferred; i++) {
+		attribute_t *attribute =
+		    attribute::get(light_endpoint_id, config->deferred[i].cluster_id, config->deferred[i].attribute_id);
+		attribute::set_deferred_persistence(attribute);
+	}
 
 	return ESP_OK;
 }
@@ -15,8 +15,13 @@
 #include <esp_matter.h>
 #include <esp_matter_console.h>
 #include <esp_matter_ota.h>
+#include <esp_ota_ops.h>
 
 #include <app_priv.h>
+#include <app_drivers.h>
+#include <diag_log.h>
+#include <radio_sched.h>
+#include APP_SKU_MANIFEST
 #include <platform/ESP32/OpenthreadLauncher.h>
 
 #include <app/server/CommissioningWindowManager.h>
@@ -61,6 +66,11 @@ static const uint16_t s_decryption_key_len = decryption_key_end - decryption_key
 static void app_event_cb(const ChipDeviceEvent *event, intptr_t arg)
 {
 	switch (event->Type) {
+	case chip::DeviceLayer::DeviceEventType::kServerReady:
+		/* onboarding codes are out, from here on logging must not wait on the UART */
+		diag_log_start_async();
+		break;
+
 	case chip::DeviceLayer::DeviceEventType::kInterfaceIpAddressChanged:
 		ESP_LOGI(__func__, "Interface IP Address changed");
 		break;
@@ -140,34 +150,23 @@ static esp_err_t app_identification_cb(identification::callback_type_t type, uin
 	return ESP_OK;
 }
 
-// This callback is called for every attribute update. The callback implementation shall
-// handle the desired attributes and return an appropriate error code. If the attribute
-// is not of your interest, please do not return an error code and strictly return ESP_OK.
-static esp_err_t app_attribute_update_cb(attribute::callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
-					 uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data)
-{
-	esp_err_t err = ESP_OK;
-
-	if (type == PRE_UPDATE) {
-		if (endpoint_id == light_endpoint_id)
-			return led_driver_attribute_update(priv_data, endpoint_id, cluster_id, attribute_id, val);
-	}
-
-	return err;
-}
-
-#define ONEWIRE_BUS_GPIO 0
-
-
 void power_management_debug(void *arg) {
-	ESP_LOGI(__func__, "DUMPING LOCK ===========  %d", esp_pm_dump_locks(stdout));
-	ESP_LOGI(__func__, "DUMPING TIMER ===========  %d", esp_timer_dump(stdout));
+	/* runs in the esp_timer task: dump into the log ring instead of blocking on the UART */
+	FILE *out = diag_log_stream();
+	ESP_LOGI(__func__, "DUMPING LOCK ===========  %d", esp_pm_dump_locks(out));
+	ESP_LOGI(__func__, "DUMPING TIMER ===========  %d", esp_timer_dump(out));
+	fflush(out);
 }
 
 extern "C" void app_main()
 {
 	esp_err_t err = ESP_OK;
 
+	err = diag_log_init();
+	if (err != ESP_OK) {
+		ESP_LOGW(__func__, "Console logging stays synchronous, err:%d", err);
+	}
+
 	/* Initialize the ESP NVS layer */
 	nvs_flash_init();
 	ESP_LOGI(__func__, "FLASH NVS initialized");
@@ -192,11 +191,20 @@ extern "C" void app_main()
 	}
 	ESP_LOGI(__func__, "matter node created");
 
+	/* Deferrable driver work is batched into the Thread radio's wakeups */
+	err = radio_sched_init();
+	if (err != ESP_OK) {
+		ESP_LOGE(__func__, "Failed to initialize the radio scheduler, err:%d", err);
+		abort();
+	}
+
 	/* Adding matter devices here! */
-	matter_board_led_init(node);
-	ESP_LOGI(__func__, "board led initialized");
-	matter_temp_init(node, ONEWIRE_BUS_GPIO);
-	ESP_LOGI(__func__, "one_wire temp initialized");
+	err = manifest::device_init(node, k_device);
+	if (err != ESP_OK) {
+		ESP_LOGE(__func__, "Failed to initialize the device endpoints, err:%d", err);
+		abort();
+	}
+	ESP_LOGI(__func__, "device endpoints initialized");
 
 #if CHIP_DEVICE_CONFIG_ENABLE_THREAD && CHIP_DEVICE_CONFIG_ENABLE_WIFI_STATION
 	// Enable secondary network interface
@@ -235,7 +243,7 @@ extern "C" void app_main()
 	ESP_LOGI(__func__, "========================Matter has started=========================");
 
 	/* Starting driver with default values */
-	led_driver_set_defaults(light_endpoint_id);
+	manifest::device_start(k_device);
 
 #if CONFIG_ENABLE_ENCRYPTED_OTA
 	err = esp_matter_ota_requestor_encrypted_init(s_decryption_key, s_decryption_key_len);
@@ -245,6 +253,15 @@ extern "C" void app_main()
 	}
 #endif // CONFIG_ENABLE_ENCRYPTED_OTA
 
+#if CONFIG_ENABLE_DELTA_OTA
+	/* Delta images only apply on top of this exact image, see tools/ota_delta.py */
+	uint8_t running_sha256[32];
+	if (esp_partition_get_sha256(esp_ota_get_running_partition(), running_sha256) == ESP_OK) {
+		ESP_LOGI(__func__, "Delta OTA base image SHA-256:");
+		ESP_LOG_BUFFER_HEX(__func__, running_sha256, sizeof(running_sha256));
+	}
+#endif // CONFIG_ENABLE_DELTA_OTA
+
 #if CONFIG_ENABLE_CHIP_SHELL
 	esp_matter::console::diagnostics_register_commands();
 	esp_matter::console::wifi_register_commands();
@@ -0,0 +1,187 @@
+#include "radio_sched.h"
+#include "radio_window.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <esp_matter_core.h>
+#include <esp_openthread.h>
+#include <esp_openthread_lock.h>
+#include <openthread/link.h>
+#include <stdlib.h>
+
+#define RADIO_SCHED_WAKE_RING 16
+/* a light sleep exit this close to our own timer was caused by us, not by the radio */
+#define RADIO_SCHED_OWN_WAKE_US 1000
+#define RADIO_SCHED_HOUR_US (3600LL * 1000 * 1000)
+/* runs in the esp_timer task: never wait long on the OpenThread task, the last period is good enough */
+#define RADIO_SCHED_OT_LOCK_TICKS pdMS_TO_TICKS(2)
+
+static radio_window s_window;
+static radio_job *s_jobs;
+static portMUX_TYPE s_jobs_lock = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_timer;
+static int64_t s_timer_due_us;
+/* jobs are running on the timer task, which arms the timer once they are done; under s_jobs_lock */
+static bool s_running;
+/* serializes stopping and restarting the timer between the timer task and deferring tasks */
+static StaticSemaphore_t s_arm_lock_buf;
+static SemaphoreHandle_t s_arm_lock;
+
+/* written from the light sleep exit callback, drained in task context */
+static int64_t s_wake_ring[RADIO_SCHED_WAKE_RING];
+static volatile uint32_t s_wake_head;
+static uint32_t s_wake_tail;
+
+static int64_t s_hour_start_us;
+static uint32_t s_hour_start_wakeups;
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+static IRAM_ATTR esp_err_t radio_sched_sleep_exit(int64_t sleep_time_us, void *arg)
+{
+	s_wake_ring[s_wake_head % RADIO_SCHED_WAKE_RING] = esp_timer_get_time();
+	s_wake_head = s_wake_head + 1;
+	return ESP_OK;
+}
+#endif
+
+static void radio_sched_learn(int64_t now_us)
+{
+	if (esp_matter::is_started() && esp_openthread_lock_acquire(RADIO_SCHED_OT_LOCK_TICKS)) {
+		int64_t period_us = 0;
+		otInstance *instance = esp_openthread_get_instance();
+#if CONFIG_OPENTHREAD_CSL_ENABLE
+		/* synchronized sleepy end device: the CSL sample window wins over data polls */
+		period_us = otLinkGetCslPeriod(instance);
+#endif
+		if (period_us == 0) {
+			period_us = (int64_t)otLinkGetPollPeriod(instance) * 1000;
+		}
+		esp_openthread_lock_release();
+		radio_window_set_period(&s_window, period_us);
+	}
+
+	uint32_t head = s_wake_head;
+	if (head - s_wake_tail > RADIO_SCHED_WAKE_RING) {
+		s_wake_tail = head - RADIO_SCHED_WAKE_RING;
+	}
+	for (; s_wake_tail != head; s_wake_tail++) {
+		int64_t wake_us = s_wake_ring[s_wake_tail % RADIO_SCHED_WAKE_RING];
+		if (llabs(wake_us - s_timer_due_us) > RADIO_SCHED_OWN_WAKE_US) {
+			radio_window_observe(&s_window, wake_us);
+		}
+	}
+
+	if (now_us - s_hour_start_us >= RADIO_SCHED_HOUR_US) {
+		ESP_LOGI(__func__, "%" PRIu32 " wakeups in the last hour, radio period %" PRId64 " us",
+			 head - s_hour_start_wakeups, s_window.period_us);
+		s_hour_start_wakeups = head;
+		s_hour_start_us = now_us;
+	}
+}
+
+static void radio_sched_arm(void)
+{
+	xSemaphoreTake(s_arm_lock, portMAX_DELAY);
+	int64_t due_us = INT64_MAX;
+	portENTER_CRITICAL(&s_jobs_lock);
+	for (radio_job *job = s_jobs; job != NULL; job = job->next) {
+		int64_t at_us = radio_window_pick(&s_window, job->earliest_us, job->deadline_us);
+		if (at_us < due_us) {
+			due_us = at_us;
+		}
+	}
+	portEXIT_CRITICAL(&s_jobs_lock);
+
+	esp_timer_stop(s_timer);
+	if (due_us != INT64_MAX) {
+		int64_t now_us = esp_timer_get_time();
+		s_timer_due_us = due_us;
+		esp_err_t err = esp_timer_start_once(s_timer, due_us > now_us ? due_us - now_us : 0);
+		if (err != ESP_OK) {
+			ESP_LOGE(__func__, "Failed to arm the scheduler timer, err:%d", err);
+		}
+	}
+	xSemaphoreGive(s_arm_lock);
+}
+
+static radio_job *radio_sched_pop(int64_t now_us)
+{
+	radio_job *due = NULL;
+	portENTER_CRITICAL(&s_jobs_lock);
+	for (radio_job **link = &s_jobs; *link != NULL; link = &(*link)->next) {
+		/* the chip is awake now anyway: take everything that may already run */
+		if ((*link)->earliest_us <= now_us + RADIO_WINDOW_LEAD_US) {
+			due = *link;
+			*link = due->next;
+			due->queued = false;
+			break;
+		}
+	}
+	portEXIT_CRITICAL(&s_jobs_lock);
+	return due;
+}
+
+static void radio_sched_run(void *arg)
+{
+	int64_t now_us = esp_timer_get_time();
+	radio_sched_learn(now_us);
+
+	portENTER_CRITICAL(&s_jobs_lock);
+	s_running = true;
+	portEXIT_CRITICAL(&s_jobs_lock);
+	radio_job *job;
+	while ((job = radio_sched_pop(now_us)) != NULL) {
+		job->fn(job->arg);
+	}
+	portENTER_CRITICAL(&s_jobs_lock);
+	s_running = false;
+	portEXIT_CRITICAL(&s_jobs_lock);
+	radio_sched_arm();
+}
+
+esp_err_t radio_sched_init(void)
+{
+	esp_timer_create_args_t timer_args = {
+	    .callback = radio_sched_run,
+	    .name = "radio_sched",
+	};
+	s_arm_lock = xSemaphoreCreateMutexStatic(&s_arm_lock_buf);
+	esp_err_t err = esp_timer_create(&timer_args, &s_timer);
+	if (err != ESP_OK) {
+		return err;
+	}
+	s_hour_start_us = esp_timer_get_time();
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+	esp_pm_sleep_cbs_register_config_t cbs_conf = {
+	    .exit_cb = radio_sched_sleep_exit,
+	};
+	err = esp_pm_light_sleep_register_cbs(&cbs_conf);
+#else
+	ESP_LOGW(__func__, "CONFIG_PM_LIGHT_SLEEP_CALLBACKS is off, jobs run unaligned");
+#endif
+	return err;
+}
+
+void radio_sched_defer(radio_job *job, int64_t delay_us, int64_t slack_us)
+{
+	int64_t now_us = esp_timer_get_time();
+	portENTER_CRITICAL(&s_jobs_lock);
+	if (!job->queued) {
+		job->next = s_jobs;
+		s_jobs = job;
+		job->queued = true;
+	}
+	job->earliest_us = now_us + delay_us;
+	job->deadline_us = job->earliest_us + slack_us;
+	/* a run in progress arms the timer after its last job and sees this one */
+	bool running = s_running;
+	portEXIT_CRITICAL(&s_jobs_lock);
+
+	if (!running) {
+		radio_sched_arm();
+	}
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Runs deferrable work (1-Wire conversions, ADC bursts, flash writes) just ahead of the next Thread
+ * data poll or CSL window, so it shares the radio's wakeup instead of causing one of its own. */
+
+struct radio_job {
+	void (*fn)(void *arg);
+	void *arg;
+	int64_t earliest_us;
+	int64_t deadline_us;
+	bool queued;
+	radio_job *next;
+};
+
+esp_err_t radio_sched_init(void);
+
+/* Queue job to run between delay_us and delay_us + slack_us from now, on a radio window if one falls in
+ * that range. The job is caller-owned and must stay valid until it ran; re-queuing a queued job moves it.
+ * Safe to call from any task and from a running job, not from an ISR. */
+void radio_sched_defer(radio_job *job, int64_t delay_us, int64_t slack_us);
@@ -0,0 +1,59 @@
+#include "radio_window.h"
+
+static int64_t radio_window_floor_mod(int64_t a, int64_t m)
+{
+	int64_t r = a % m;
+	return r < 0 ? r + m : r;
+}
+
+void radio_window_set_period(radio_window *w, int64_t period_us)
+{
+	if (period_us != w->period_us) {
+		w->period_us = period_us;
+		w->misses = 0;
+	}
+}
+
+void radio_window_observe(radio_window *w, int64_t wake_us)
+{
+	if (w->period_us <= 0) {
+		return;
+	}
+	if (!w->locked) {
+		w->anchor_us = wake_us;
+		w->locked = true;
+		w->misses = 0;
+		return;
+	}
+
+	/* phase error folded into [-period/2, period/2) */
+	int64_t err = radio_window_floor_mod(wake_us - w->anchor_us + w->period_us / 2, w->period_us) -
+		      w->period_us / 2;
+	if (err > -w->period_us / RADIO_WINDOW_TOLERANCE_DIV && err < w->period_us / RADIO_WINDOW_TOLERANCE_DIV) {
+		/* follow clock drift and poll jitter slowly */
+		w->anchor_us = wake_us - err + err / 8;
+		w->misses = 0;
+	} else if (++w->misses >= RADIO_WINDOW_RELOCK) {
+		/* the anchor was probably some other timer's wakeup */
+		w->anchor_us = wake_us;
+		w->misses = 0;
+	}
+}
+
+int64_t radio_window_next(const radio_window *w, int64_t t)
+{
+	if (w->period_us <= 0 || !w->locked) {
+		return -1;
+	}
+	return t + radio_window_floor_mod(w->anchor_us - t, w->period_us);
+}
+
+int64_t radio_window_pick(const radio_window *w, int64_t earliest_us, int64_t deadline_us)
+{
+	int64_t window = radio_window_next(w, earliest_us + RADIO_WINDOW_LEAD_US);
+	if (window < 0) {
+		return earliest_us;
+	}
+	window -= RADIO_WINDOW_LEAD_US;
+	return window <= deadline_us ? window : earliest_us;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Predicts when the 802.15.4 radio wakes up next, from the poll/CSL period and the wakeups actually seen.
+ * Pure bookkeeping, times in us on the esp_timer clock. */
+
+/* wakeups closer than this to the predicted window keep the lock and nudge the phase */
+#define RADIO_WINDOW_TOLERANCE_DIV 16
+/* off-phase wakeups in a row before the phase is re-anchored */
+#define RADIO_WINDOW_RELOCK 8
+/* work is placed this long before a window, so the chip is still awake when the radio needs it */
+#define RADIO_WINDOW_LEAD_US 3000
+
+struct radio_window {
+	int64_t period_us;
+	int64_t anchor_us;
+	bool locked;
+	uint8_t misses;
+};
+
+void radio_window_set_period(radio_window *w, int64_t period_us);
+void radio_window_observe(radio_window *w, int64_t wake_us);
+
+/* Start of the first predicted window at or after t, -1 when unknown */
+int64_t radio_window_next(const radio_window *w, int64_t t);
+
+/* When to run work that may start at earliest and must start by deadline: just ahead of the first window
+ * in range, else at earliest: a deadline off any window is no cheaper and only adds delay */
+int64_t radio_window_pick(const radio_window *w, int64_t earliest_us, int64_t deadline_us);
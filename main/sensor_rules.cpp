@@ -0,0 +1,62 @@
+#include "sensor_rules.h"
+#include <stdlib.h>
+
+#define SENSOR_RULE_MINUTE_US (60LL * 1000 * 1000)
+
+static bool sensor_rule_rate(const sensor_rule *rule, sensor_rule_state *state, int16_t value, int64_t now_us)
+{
+	if (!state->have_last || now_us <= state->last_us) {
+		return state->active;
+	}
+	/* |delta| / dt > limit / minute, cross-multiplied to stay in integers */
+	int64_t delta = abs(value - state->last);
+	return delta * SENSOR_RULE_MINUTE_US > (int64_t)rule->limit * (now_us - state->last_us);
+}
+
+static bool sensor_rule_stuck(const sensor_rule *rule, sensor_rule_state *state, int16_t value)
+{
+	if (rule->count == 0) {
+		return false;
+	}
+	if (state->have_last && abs(value - state->last) <= rule->limit) {
+		if (state->same < UINT16_MAX) {
+			state->same++;
+		}
+	} else {
+		state->same = 0;
+	}
+	/* same counts repeats, so count samples in a row means count - 1 repeats */
+	return state->same + 1 >= rule->count;
+}
+
+bool sensor_rule_eval(const sensor_rule *rule, sensor_rule_state *state, int16_t value, int64_t now_us)
+{
+	switch (rule->kind) {
+	case SENSOR_RULE_ABOVE:
+		state->active = state->active ? value > rule->limit - rule->hysteresis : value > rule->limit;
+		break;
+	case SENSOR_RULE_BELOW:
+		state->active = state->active ? value < rule->limit + rule->hysteresis : value < rule->limit;
+		break;
+	case SENSOR_RULE_RATE:
+		state->active = sensor_rule_rate(rule, state, value, now_us);
+		break;
+	case SENSOR_RULE_STUCK:
+		state->active = sensor_rule_stuck(rule, state, value);
+		break;
+	}
+	state->have_last = true;
+	state->last = value;
+	state->last_us = now_us;
+	return state->active;
+}
+
+bool sensor_rules_eval(const sensor_rule *rules, sensor_rule_state *states, int nr_rules, int16_t value,
+		       int64_t now_us)
+{
+	bool active = false;
+	for (int i = 0; i < nr_rules; i++) {
+		active |= sensor_rule_eval(&rules[i], &states[i], value, now_us);
+	}
+	return active;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Local alarm rules, evaluated on every sample so an alarm does not wait for the next report.
+ * Values are fixed-point (centi-degrees for temperature), each rule keeps O(1) state. */
+
+enum sensor_rule_kind {
+	SENSOR_RULE_ABOVE,	/* value > limit, clears below limit - hysteresis */
+	SENSOR_RULE_BELOW,	/* value < limit, clears above limit + hysteresis */
+	SENSOR_RULE_RATE,	/* |change| > limit per minute */
+	SENSOR_RULE_STUCK,	/* count samples in a row within limit of each other, count 0 disables it */
+};
+
+/* rules per sensor, each keeps its sensor_rule_state per probe */
+#define SENSOR_RULES_MAX 4
+
+struct sensor_rule {
+	sensor_rule_kind kind;
+	int16_t limit;
+	int16_t hysteresis;
+	uint16_t count;
+};
+
+struct sensor_rule_state {
+	bool active;
+	bool have_last;
+	int16_t last;
+	int64_t last_us;
+	uint16_t same;
+};
+
+/* Feeds one sample, returns whether the rule is active afterwards */
+bool sensor_rule_eval(const sensor_rule *rule, sensor_rule_state *state, int16_t value, int64_t now_us);
+
+/* Feeds one sample to every rule, returns whether any of them is active */
+bool sensor_rules_eval(const sensor_rule *rules, sensor_rule_state *states, int nr_rules, int16_t value,
+		       int64_t now_us);
@@ -0,0 +1,47 @@
+/* ESP32-H2 devkit: board RGB LED as an extended color light, DS18B20 probes on GPIO0 with local
+ * over/under temperature, rate and stuck-sensor alarms */
+
+#pragma once
+
+#include <app_priv.h>
+#include <device_manifest.h>
+
+static constexpr manifest::attribute_ref k_light_deferred[] = {
+    {chip::app::Clusters::LevelControl::Id, chip::app::Clusters::LevelControl::Attributes::CurrentLevel::Id},
+    {chip::app::Clusters::ColorControl::Id, chip::app::Clusters::ColorControl::Attributes::CurrentX::Id},
+    {chip::app::Clusters::ColorControl::Id, chip::app::Clusters::ColorControl::Attributes::CurrentY::Id},
+    {chip::app::Clusters::ColorControl::Id,
+     chip::app::Clusters::ColorControl::Attributes::ColorTemperatureMireds::Id},
+};
+
+static constexpr sensor_rule k_temp_rules[] = {
+    {.kind = SENSOR_RULE_ABOVE, .limit = 3500, .hysteresis = 100},
+    {.kind = SENSOR_RULE_BELOW, .limit = 500, .hysteresis = 100},
+    /* 3 degrees per minute */
+    {.kind = SENSOR_RULE_RATE, .limit = 300},
+    /* a day of identical samples at the 30 s sampling period: at 0.25 degree steps a quiet room can read
+     * the same for hours. A probe stuck at its 85.00 power-on value already trips the ABOVE rule. */
+    {.kind = SENSOR_RULE_STUCK, .limit = 0, .count = 2880},
+};
+static_assert(sizeof(k_temp_rules) / sizeof(k_temp_rules[0]) <= SENSOR_RULES_MAX,
+	      "more temperature rules than SENSOR_RULES_MAX");
+
+static constexpr manifest::device<manifest::color_light, manifest::temp_probes> k_device = {
+    manifest::color_light{
+	.on_off = false,
+	.level = DEFAULT_BRIGHTNESS / 4,
+	.color_mode = (uint8_t)chip::app::Clusters::ColorControl::ColorMode::kColorTemperature,
+	.deferred = k_light_deferred,
+	.nr_deferred = sizeof(k_light_deferred) / sizeof(k_light_deferred[0]),
+    },
+    manifest::temp_probes{
+	.gpio = 0,
+	.policy =
+	    {
+		.deadband = DEFAULT_TEMP_DEADBAND,
+		.guard = DEFAULT_TEMP_GUARD,
+	    },
+	.rules = k_temp_rules,
+	.nr_rules = sizeof(k_temp_rules) / sizeof(k_temp_rules[0]),
+    },
+};
@@ -0,0 +1,286 @@
+#include "temp_bus.h"
+#include <string.h>
+
+static void temp_bus_set_health(temp_bus *bus, int slot, temp_probe_health health)
+{
+	temp_bus_probe *probe = &bus->probes[slot];
+	if (probe->health == health) {
+		return;
+	}
+	probe->health = health;
+	if (bus->ops->on_health) {
+		bus->ops->on_health(bus->ctx, slot, health);
+	}
+}
+
+static const temp_policy *temp_bus_policy_of(const temp_bus *bus, uint64_t address)
+{
+	for (int i = 0; i < bus->nr_probe_policies; i++) {
+		if (bus->probe_policies[i].address == address) {
+			return &bus->probe_policies[i].policy;
+		}
+	}
+	return &bus->default_policy;
+}
+
+static void temp_bus_probe_reset(temp_bus *bus, temp_bus_probe *probe, uint64_t address)
+{
+	temp_probe_counters counters = probe->counters;
+	memset(probe, 0, sizeof(*probe));
+	probe->address = address;
+	probe->health = TEMP_PROBE_OK;
+	probe->policy = *temp_bus_policy_of(bus, address);
+	probe->resolution = temp_policy_pick(&probe->policy, false, 0);
+	temp_conv_stats_init(&probe->conv);
+	/* a replacement keeps the slot's history */
+	probe->counters = counters;
+}
+
+void temp_bus_init(temp_bus *bus, const temp_bus_ops *ops, void *ctx, const temp_policy *policy)
+{
+	memset(bus, 0, sizeof(*bus));
+	bus->ops = ops;
+	bus->ctx = ctx;
+	bus->default_policy = *policy;
+	bus->current = -1;
+}
+
+esp_err_t temp_bus_set_probe_policy(temp_bus *bus, uint64_t address, const temp_policy *policy)
+{
+	int i = 0;
+	while (i < bus->nr_probe_policies && bus->probe_policies[i].address != address) {
+		i++;
+	}
+	if (i == TEMP_BUS_MAX_PROBES) {
+		return ESP_ERR_NO_MEM;
+	}
+	if (i == bus->nr_probe_policies) {
+		bus->nr_probe_policies++;
+	}
+	bus->probe_policies[i] = {address, *policy};
+
+	for (int slot = 0; slot < bus->nr_probes; slot++) {
+		if (bus->probes[slot].address == address) {
+			bus->probes[slot].policy = *policy;
+		}
+	}
+	return ESP_OK;
+}
+
+bool temp_bus_busy(const temp_bus *bus)
+{
+	return bus->phase != TEMP_BUS_IDLE;
+}
+
+static bool temp_bus_address_listed(const uint64_t *addresses, int nr, uint64_t address)
+{
+	for (int i = 0; i < nr; i++) {
+		if (addresses[i] == address) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static int temp_bus_slot_of(const temp_bus *bus, uint64_t address)
+{
+	for (int slot = 0; slot < bus->nr_probes; slot++) {
+		if (bus->probes[slot].address == address) {
+			return slot;
+		}
+	}
+	return -1;
+}
+
+esp_err_t temp_bus_rescan(temp_bus *bus)
+{
+	uint64_t found[TEMP_BUS_MAX_PROBES];
+	int nr_found = 0;
+	esp_err_t err = bus->ops->search(bus->ctx, found, TEMP_BUS_MAX_PROBES, &nr_found);
+	if (err != ESP_OK) {
+		return err;
+	}
+	bus->rounds_since_rescan = 0;
+
+	for (int slot = 0; slot < bus->nr_probes; slot++) {
+		temp_bus_probe *probe = &bus->probes[slot];
+		if (!temp_bus_address_listed(found, nr_found, probe->address)) {
+			if (probe->health != TEMP_PROBE_MISSING) {
+				probe->counters.lost++;
+			}
+			temp_bus_set_health(bus, slot, TEMP_PROBE_MISSING);
+		} else if (probe->health != TEMP_PROBE_OK) {
+			/* back on probation: one more failed reading takes it out again */
+			probe->consecutive_failures = TEMP_BUS_UNHEALTHY_AFTER - 1;
+			temp_bus_set_health(bus, slot, TEMP_PROBE_OK);
+		}
+	}
+
+	for (int i = 0; i < nr_found; i++) {
+		if (temp_bus_slot_of(bus, found[i]) >= 0) {
+			continue;
+		}
+		/* a probe swapped on a cable run takes over the slot of the one that went missing */
+		int slot = -1;
+		for (int s = 0; s < bus->nr_probes; s++) {
+			if (bus->probes[s].health == TEMP_PROBE_MISSING) {
+				slot = s;
+				break;
+			}
+		}
+		if (slot < 0) {
+			if (bus->nr_probes >= TEMP_BUS_MAX_PROBES) {
+				continue;
+			}
+			slot = bus->nr_probes;
+		}
+		if (bus->ops->attach(bus->ctx, slot, found[i]) != ESP_OK) {
+			continue;
+		}
+		if (slot == bus->nr_probes) {
+			bus->nr_probes++;
+		}
+		temp_bus_probe *probe = &bus->probes[slot];
+		temp_probe_health previous = probe->health;
+		temp_bus_probe_reset(bus, probe, found[i]);
+		probe->health = previous;
+		temp_bus_set_health(bus, slot, TEMP_PROBE_OK);
+	}
+	return ESP_OK;
+}
+
+static bool temp_bus_degraded(const temp_bus *bus)
+{
+	for (int slot = 0; slot < bus->nr_probes; slot++) {
+		if (bus->probes[slot].health != TEMP_PROBE_OK) {
+			return true;
+		}
+	}
+	return bus->nr_probes == 0;
+}
+
+static int64_t temp_bus_begin(temp_bus *bus, int64_t now_us);
+
+static int64_t temp_bus_advance(temp_bus *bus, int64_t now_us)
+{
+	while (++bus->current < bus->nr_probes) {
+		if (bus->probes[bus->current].health == TEMP_PROBE_OK) {
+			bus->attempt = 0;
+			return temp_bus_begin(bus, now_us);
+		}
+	}
+	bus->current = -1;
+	bus->phase = TEMP_BUS_IDLE;
+	bus->rounds_since_rescan++;
+	return TEMP_BUS_DONE;
+}
+
+static int64_t temp_bus_fail(temp_bus *bus, int64_t now_us, esp_err_t err)
+{
+	temp_bus_probe *probe = &bus->probes[bus->current];
+	switch (err) {
+	case ESP_ERR_INVALID_CRC:
+		probe->counters.crc_errors++;
+		break;
+	case ESP_ERR_NOT_FOUND:
+		probe->counters.no_presence++;
+		break;
+	case ESP_ERR_TIMEOUT:
+		probe->counters.timeouts++;
+		break;
+	default:
+		probe->counters.bus_errors++;
+		break;
+	}
+
+	if (++bus->attempt < TEMP_BUS_MAX_ATTEMPTS) {
+		probe->counters.retries++;
+		bus->phase = TEMP_BUS_BACKOFF;
+		return (int64_t)TEMP_BUS_BACKOFF_US << (bus->attempt - 1);
+	}
+
+	probe->counters.failed_readings++;
+	if (++probe->consecutive_failures >= TEMP_BUS_UNHEALTHY_AFTER) {
+		temp_bus_set_health(bus, bus->current, TEMP_PROBE_UNHEALTHY);
+	}
+	return temp_bus_advance(bus, now_us);
+}
+
+static int64_t temp_bus_begin(temp_bus *bus, int64_t now_us)
+{
+	temp_bus_probe *probe = &bus->probes[bus->current];
+	temp_resolution res = temp_policy_pick(&probe->policy, probe->have_last, probe->last);
+	esp_err_t err = bus->ops->start_conversion(bus->ctx, bus->current, res);
+	if (err != ESP_OK) {
+		return temp_bus_fail(bus, now_us, err);
+	}
+	probe->resolution = res;
+	bus->conv_start_us = now_us;
+	bus->phase = TEMP_BUS_CONVERTING;
+
+	/* First look slightly before the learned time, so the estimate can shrink as well as grow */
+	uint32_t expected_us = temp_conv_expected_us(&probe->conv, res);
+	bus->poll_due_us = now_us + expected_us - expected_us / 8;
+	return expected_us - expected_us / 8;
+}
+
+static int64_t temp_bus_poll(temp_bus *bus, int64_t now_us)
+{
+	temp_bus_probe *probe = &bus->probes[bus->current];
+	uint32_t max_us = temp_resolution_max_conv_us(probe->resolution);
+	uint32_t elapsed_us = (uint32_t)(now_us - bus->conv_start_us);
+
+	bool done = false;
+	esp_err_t err = bus->ops->conversion_done(bus->ctx, bus->current, &done);
+	if (err != ESP_OK) {
+		return temp_bus_fail(bus, now_us, err);
+	}
+	if (!done) {
+		if (elapsed_us >= max_us + max_us / 4) {
+			return temp_bus_fail(bus, now_us, ESP_ERR_TIMEOUT);
+		}
+		bus->poll_due_us = now_us + max_us / 16;
+		return max_us / 16;
+	}
+	if (now_us - bus->poll_due_us < max_us / 16) {
+		temp_conv_learn(&probe->conv, probe->resolution, elapsed_us);
+	}
+
+	int16_t centi;
+	err = bus->ops->read(bus->ctx, bus->current, &centi);
+	if (err != ESP_OK) {
+		return temp_bus_fail(bus, now_us, err);
+	}
+	probe->counters.readings++;
+	probe->consecutive_failures = 0;
+	probe->have_last = true;
+	probe->last = centi;
+	bus->ops->on_reading(bus->ctx, bus->current, centi);
+	return temp_bus_advance(bus, now_us);
+}
+
+int64_t temp_bus_start_round(temp_bus *bus, int64_t now_us)
+{
+	if (temp_bus_busy(bus)) {
+		return TEMP_BUS_DONE;
+	}
+	uint32_t interval = temp_bus_degraded(bus) ? TEMP_BUS_RESCAN_ROUNDS_DEGRADED : TEMP_BUS_RESCAN_ROUNDS;
+	if (bus->rounds_since_rescan >= interval) {
+		/* a failed search is retried next round; the known probes are still worth reading */
+		temp_bus_rescan(bus);
+	}
+	bus->current = -1;
+	return temp_bus_advance(bus, now_us);
+}
+
+int64_t temp_bus_step(temp_bus *bus, int64_t now_us)
+{
+	switch (bus->phase) {
+	case TEMP_BUS_BACKOFF:
+		return temp_bus_begin(bus, now_us);
+	case TEMP_BUS_CONVERTING:
+		return temp_bus_poll(bus, now_us);
+	default:
+		return TEMP_BUS_DONE;
+	}
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "temp_policy.h"
+
+/* Bus state machine for the 1-Wire temperature probes. It never blocks and never aborts: the caller
+ * feeds it the current time and sleeps for the delay it returns. All hardware access goes through
+ * temp_bus_ops, so the retry and rescan logic also runs against a fault-injecting mock on the host. */
+
+#define TEMP_BUS_MAX_PROBES 4
+/* attempts per reading before it counts as failed */
+#define TEMP_BUS_MAX_ATTEMPTS 3
+/* first retry backoff, doubled on every further attempt */
+#define TEMP_BUS_BACKOFF_US 20000
+/* consecutive failed readings before a probe is taken out of rotation */
+#define TEMP_BUS_UNHEALTHY_AFTER 3
+/* rounds between ROM rescans, and while some probe is unhealthy or missing */
+#define TEMP_BUS_RESCAN_ROUNDS 20
+#define TEMP_BUS_RESCAN_ROUNDS_DEGRADED 4
+
+/** returned by temp_bus_start_round() and temp_bus_step() once the round is over */
+#define TEMP_BUS_DONE (-1)
+
+enum temp_probe_health {
+	TEMP_PROBE_OK,
+	TEMP_PROBE_UNHEALTHY,
+	TEMP_PROBE_MISSING,
+};
+
+struct temp_probe_counters {
+	uint32_t readings;
+	uint32_t crc_errors;
+	uint32_t no_presence;
+	uint32_t timeouts;
+	uint32_t bus_errors;
+	uint32_t retries;
+	uint32_t failed_readings;
+	uint32_t lost;
+};
+
+struct temp_bus_probe {
+	uint64_t address;
+	temp_probe_health health;
+	uint8_t consecutive_failures;
+	temp_policy policy;
+	temp_conv_stats conv;
+	temp_resolution resolution;
+	bool have_last;
+	int16_t last;
+	temp_probe_counters counters;
+};
+
+struct temp_bus_ops {
+	/* fill up to max ROM addresses of the DS18B20s present on the bus */
+	esp_err_t (*search)(void *ctx, uint64_t *addresses, int max, int *found);
+	/* a probe (new or replacing a missing one) now lives in slot */
+	esp_err_t (*attach)(void *ctx, int slot, uint64_t address);
+	/* program res if needed and issue CONVERT T */
+	esp_err_t (*start_conversion)(void *ctx, int slot, temp_resolution res);
+	esp_err_t (*conversion_done)(void *ctx, int slot, bool *done);
+	/* read the scratchpad, CRC checked, in centi-degrees */
+	esp_err_t (*read)(void *ctx, int slot, int16_t *centi);
+
+	void (*on_reading)(void *ctx, int slot, int16_t centi);
+	void (*on_health)(void *ctx, int slot, temp_probe_health health);
+};
+
+/** Policy for one probe by ROM address, instead of the bus default */
+struct temp_bus_probe_policy {
+	uint64_t address;
+	temp_policy policy;
+};
+
+enum temp_bus_phase {
+	TEMP_BUS_IDLE,
+	TEMP_BUS_CONVERTING,
+	TEMP_BUS_BACKOFF,
+};
+
+struct temp_bus {
+	const temp_bus_ops *ops;
+	void *ctx;
+	temp_policy default_policy;
+	temp_bus_probe_policy probe_policies[TEMP_BUS_MAX_PROBES];
+	int nr_probe_policies;
+	temp_bus_probe probes[TEMP_BUS_MAX_PROBES];
+	int nr_probes;
+
+	temp_bus_phase phase;
+	int current;
+	uint8_t attempt;
+	int64_t conv_start_us;
+	/* when the caller was asked to poll; a late poll says nothing about the conversion time */
+	int64_t poll_due_us;
+	uint32_t rounds_since_rescan;
+};
+
+void temp_bus_init(temp_bus *bus, const temp_bus_ops *ops, void *ctx, const temp_policy *policy);
+
+/* Gives the probe with this ROM address its own policy, now if it is attached and whenever it is
+ * attached again; ESP_ERR_NO_MEM past TEMP_BUS_MAX_PROBES addresses */
+esp_err_t temp_bus_set_probe_policy(temp_bus *bus, uint64_t address, const temp_policy *policy);
+
+/* Full ROM search; reconciles the slots with what answered and attaches new probes */
+esp_err_t temp_bus_rescan(temp_bus *bus);
+
+bool temp_bus_busy(const temp_bus *bus);
+
+/* Both return the delay in us until temp_bus_step() wants to run again, or TEMP_BUS_DONE */
+int64_t temp_bus_start_round(temp_bus *bus, int64_t now_us);
+int64_t temp_bus_step(temp_bus *bus, int64_t now_us);
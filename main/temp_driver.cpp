@@ -1,3 +1,6 @@
+#include "alloc_stats.h"
+#include "attr_cache.h"
+#include "diag_log.h"
 #include "ds18b20.h"
 #include "esp_log.h"
 #include <esp_matter.h>
@@ -5,134 +8,426 @@
 #include "esp_matter_core.h"
 #include "esp_matter_endpoint.h"
 #include "onewire_bus.h"
+#include "radio_sched.h"
+#include "sensor_rules.h"
+#include "temp_bus.h"
+#include "temp_policy.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include <app_priv.h>
+#include <app_drivers.h>
 
 using namespace esp_matter;
 using namespace esp_matter::endpoint;
 using namespace chip::app::Clusters;
 
-struct sensor_reader_ctx {
+#define TEMP_FAMILY_DS18B20 0x28
+#define TEMP_CMD_MATCH_ROM 0x55
+#define TEMP_CMD_CONVERT_T 0x44
+
+#define TEMP_SAMPLE_PERIOD_US (30 * 1000 * 1000)
+/* how far a sampling round or a scratchpad read may slip to meet a radio window */
+#define TEMP_SAMPLE_SLACK_US (5 * 1000 * 1000)
+#define TEMP_READ_SLACK_US (2 * 1000 * 1000)
+
+/* with alarms raised locally, MeasuredValue is only pushed on a deadband change or this often */
+#define TEMP_REPORT_HEARTBEAT_US (15LL * 60 * 1000 * 1000)
+
+struct temp_probe {
 	ds18b20_device_handle_t ds18b20;
-	uint16_t temp_endpoint_id;
+	/* resolution in the scratchpad, TEMP_RES_COUNT when unknown */
+	temp_resolution programmed;
+	endpoint_t *endpoint;
+	attr_slot measured_value;
+	attr_slot alarm;
+	sensor_rule_state rule_states[SENSOR_RULES_MAX];
+	bool alarm_active;
+	bool have_reported;
+	int16_t reported;
+	int64_t reported_us;
+};
+
+struct sensor_reader_ctx {
+	node_t *node;
+	onewire_bus_handle_t onewire;
+	const sensor_rule *rules;
+	int nr_rules;
+	temp_bus bus;
+	temp_probe probes[TEMP_BUS_MAX_PROBES];
+	radio_job round_job;
+	radio_job step_job;
+	bool steady_state;
 } s_ctx;
 
+/* the soak build turns this off and runs the real probe path against its bus model */
+#ifndef TODO_FAKE_TEMP
 #define TODO_FAKE_TEMP true
+#endif
 
 #if TODO_FAKE_TEMP
 	int fake_temp = 2000;
 #endif
 
-void temp_sensor_reader(void *arg)
+static esp_err_t temp_endpoint_bind(struct sensor_reader_ctx *ctx, temp_probe *probe)
 {
-	struct sensor_reader_ctx *s_ctx = (struct sensor_reader_ctx *)arg;
-	float temperature;
-#if !TODO_FAKE_TEMP
+	uint16_t endpoint_id = endpoint::get_id(probe->endpoint);
+	esp_err_t err = attr_slot_bind(&probe->measured_value, endpoint_id, TemperatureMeasurement::Id,
+				       TemperatureMeasurement::Attributes::MeasuredValue::Id);
+	if (err != ESP_OK || ctx->nr_rules == 0) {
+		return err;
+	}
+	cluster::boolean_state::config_t alarm_config;
+	if (cluster::boolean_state::create(probe->endpoint, &alarm_config, CLUSTER_FLAG_SERVER) == nullptr) {
+		ESP_LOGE(__func__, "Failed to create the alarm cluster on endpoint %d", endpoint_id);
+		return ESP_ERR_NO_MEM;
+	}
+	return attr_slot_bind(&probe->alarm, endpoint_id, BooleanState::Id, BooleanState::Attributes::StateValue::Id);
+}
 
-	ds18b20_device_handle_t dev_handle = s_ctx->ds18b20;
-	ESP_ERROR_CHECK(ds18b20_trigger_temperature_conversion(dev_handle));
-	ESP_ERROR_CHECK(ds18b20_get_temperature(dev_handle, &temperature));
-	ESP_LOGI(__func__, "Temperature data read: %f", temperature);
+/* Probes hot-plugged after start-up are added from the timer task, so a failure only leaves the slot
+ * unattached for the next rescan to retry */
+static esp_err_t temp_endpoint_create(struct sensor_reader_ctx *ctx, int slot)
+{
+	temp_probe *probe = &ctx->probes[slot];
+	bool started = esp_matter::is_started();
+	lock::status_t lock_status = started ? lock::chip_stack_lock(portMAX_DELAY) : lock::ALREADY_TAKEN;
 
-	esp_matter_attr_val_t val = esp_matter_int(temperature * 100);
-	attribute::update(s_ctx->temp_endpoint_id, TemperatureMeasurement::Id,
-			  TemperatureMeasurement::Attributes::MeasuredValue::Id, &val);
-#else
-	esp_matter_attr_val_t val = esp_matter_int(fake_temp);
-	attribute::update(s_ctx->temp_endpoint_id, TemperatureMeasurement::Id,
-			  TemperatureMeasurement::Attributes::MeasuredValue::Id, &val);
-	fake_temp += 50;
-	if (fake_temp > 4000) fake_temp = 2000;
-#endif
+	esp_err_t err = ESP_OK;
+	temperature_sensor::config_t matter_temp_config;
+	probe->endpoint = temperature_sensor::create(ctx->node, &matter_temp_config, ENDPOINT_FLAG_NONE, probe);
+	if (probe->endpoint == nullptr) {
+		ESP_LOGE(__func__, "Failed to create a temperature endpoint");
+		err = ESP_ERR_NO_MEM;
+	} else {
+		ESP_LOGI(__func__, "Temp created with endpoint_id %d", endpoint::get_id(probe->endpoint));
+		err = temp_endpoint_bind(ctx, probe);
+		if (err != ESP_OK) {
+			endpoint::destroy(ctx->node, probe->endpoint);
+			probe->endpoint = nullptr;
+		} else if (started) {
+			endpoint::enable(probe->endpoint);
+		}
+	}
+	if (lock_status == lock::SUCCESS) {
+		lock::chip_stack_unlock();
+	}
+	return err;
 }
 
-#define MAX_NR_DEV 1
-int matter_temp_init(node_t *node, int gpio_pin)
+static void temp_on_reading(void *arg, int slot, int16_t centi)
 {
-	// install new 1-wire bus
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
+	temp_probe *probe = &ctx->probes[slot];
+	int64_t now_us = esp_timer_get_time();
+	/* every sample, so a trace record rather than a formatted line */
+	diag_trace(DIAG_TRACE_TEMP_READING, slot, (uint32_t)centi);
+
+	bool alarm = sensor_rules_eval(ctx->rules, probe->rule_states, ctx->nr_rules, centi, now_us);
+	bool alarm_changed = alarm != probe->alarm_active;
+	if (alarm_changed) {
+		ESP_LOGW(__func__, "Probe %d alarm %s at %d.%02d", slot, alarm ? "raised" : "cleared", centi / 100,
+			 abs(centi % 100));
+		probe->alarm_active = alarm;
+		esp_matter_attr_val_t alarm_val = esp_matter_bool(alarm);
+		attr_slot_push(&probe->alarm, &alarm_val);
+	}
+
+	if (probe->have_reported && !alarm_changed &&
+	    abs(centi - probe->reported) < ctx->bus.probes[slot].policy.deadband &&
+	    now_us - probe->reported_us < TEMP_REPORT_HEARTBEAT_US) {
+		return;
+	}
+	probe->have_reported = true;
+	probe->reported = centi;
+	probe->reported_us = now_us;
+	esp_matter_attr_val_t val = esp_matter_nullable_int16(centi);
+	attr_slot_push(&probe->measured_value, &val);
+}
+
+static void temp_on_health(void *arg, int slot, temp_probe_health health)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
+	const temp_bus_probe *probe = &ctx->bus.probes[slot];
+	const temp_probe_counters *c = &probe->counters;
+	ESP_LOGW(__func__,
+		 "Probe %d (%016" PRIX64 ") %s: readings %" PRIu32 " crc %" PRIu32 " presence %" PRIu32 " timeout %" PRIu32
+		 " bus %" PRIu32 " retries %" PRIu32 " failed %" PRIu32 " lost %" PRIu32,
+		 slot, probe->address,
+		 health == TEMP_PROBE_OK ? "healthy" : health == TEMP_PROBE_UNHEALTHY ? "unhealthy" : "missing",
+		 c->readings, c->crc_errors, c->no_presence, c->timeouts, c->bus_errors, c->retries,
+		 c->failed_readings, c->lost);
+	if (health != TEMP_PROBE_OK) {
+		/* report "unknown" rather than a stale value */
+		ctx->probes[slot].have_reported = false;
+		esp_matter_attr_val_t val = esp_matter_nullable_int16(nullable<int16_t>());
+		attr_slot_push(&ctx->probes[slot].measured_value, &val);
+	}
+}
+
 #if !TODO_FAKE_TEMP
-	onewire_bus_handle_t bus;
-	onewire_bus_config_t bus_config = {
-	    .bus_gpio_num = gpio_pin,
-	};
-	onewire_bus_rmt_config_t rmt_config = {
-	    .max_rx_bytes = 10, // 1byte ROM command + 8byte ROM number + 1byte device command
-	};
-	ESP_ERROR_CHECK(onewire_new_bus_rmt(&bus_config, &rmt_config, &bus));
-	ESP_LOGI(__func__, "1-Wire bus installed on GPIO%d", gpio_pin);
+static ds18b20_resolution_t temp_ds18b20_resolution(temp_resolution res)
+{
+	switch (res) {
+	case TEMP_RES_9B:
+		return DS18B20_RESOLUTION_9B;
+	case TEMP_RES_10B:
+		return DS18B20_RESOLUTION_10B;
+	case TEMP_RES_11B:
+		return DS18B20_RESOLUTION_11B;
+	default:
+		return DS18B20_RESOLUTION_12B;
+	}
+}
 
-	int ds18b20_device_num = 0;
+static esp_err_t temp_search(void *arg, uint64_t *addresses, int max, int *found)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
 	onewire_device_iter_handle_t iter = NULL;
 	onewire_device_t next_onewire_device;
-	esp_err_t search_result = ESP_OK;
-	ds18b20_device_handle_t temp_handle;
-
-	// create 1-wire device iterator, which is used for device search
-	ESP_ERROR_CHECK(onewire_new_device_iter(bus, &iter));
-	ESP_LOGI(__func__, "Device iterator created, start searching...");
+	esp_err_t search_result = onewire_new_device_iter(ctx->onewire, &iter);
+	if (search_result != ESP_OK) {
+		return search_result;
+	}
+	*found = 0;
 	do {
 		search_result = onewire_device_iter_get_next(iter, &next_onewire_device);
-		if (search_result == ESP_OK) { // found a new device, let's check if we can upgrade it to a DS18B20
-			ds18b20_config_t ds_cfg = {};
-			if (ds18b20_new_device(&next_onewire_device, &ds_cfg, &temp_handle) == ESP_OK) {
-				ESP_LOGI(__func__, "Found a DS18B20[%d], address: %016llX", ds18b20_device_num,
-					 next_onewire_device.address);
-				ds18b20_device_num++;
-				if (ds18b20_device_num >= MAX_NR_DEV) {
-					ESP_LOGI(__func__, "Max DS18B20 number reached, stop searching...");
-					break;
-				}
-			} else {
-				ESP_LOGI(__func__, "Found an unknown device, address: %016llX",
+		if (search_result == ESP_OK) {
+			if ((next_onewire_device.address & 0xFF) != TEMP_FAMILY_DS18B20) {
+				ESP_LOGI(__func__, "Found an unknown device, address: %016" PRIX64,
 					 next_onewire_device.address);
+			} else if (*found < max) {
+				addresses[(*found)++] = next_onewire_device.address;
 			}
 		}
-	} while (search_result != ESP_ERR_NOT_FOUND);
-	ESP_ERROR_CHECK(onewire_del_device_iter(iter));
-	ESP_LOGI(__func__, "Searching done, %d DS18B20 device(s) found", ds18b20_device_num);
+	} while (search_result == ESP_OK);
+	onewire_del_device_iter(iter);
+	return search_result == ESP_ERR_NOT_FOUND ? ESP_OK : search_result;
+}
 
-	// set resolution for all DS18B20s
-	for (int i = 0; i < ds18b20_device_num; i++) {
-		// set resolution
-		ESP_ERROR_CHECK(ds18b20_set_resolution(temp_handle, DS18B20_RESOLUTION_9B));
+static esp_err_t temp_attach(void *arg, int slot, uint64_t address)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
+	temp_probe *probe = &ctx->probes[slot];
+	if (probe->ds18b20 != NULL) {
+		ds18b20_del_device(probe->ds18b20);
+		probe->ds18b20 = NULL;
 	}
+	onewire_device_t dev = {
+	    .bus = ctx->onewire,
+	    .address = address,
+	};
+	ds18b20_config_t ds_cfg = {};
+	esp_err_t err = ds18b20_new_device(&dev, &ds_cfg, &probe->ds18b20);
+	if (err != ESP_OK) {
+		return err;
+	}
+	ESP_LOGI(__func__, "DS18B20 %016" PRIX64 " attached to probe %d", address, slot);
+	probe->programmed = TEMP_RES_COUNT;
+	/* a replacement probe starts its rules from scratch */
+	memset(probe->rule_states, 0, sizeof(probe->rule_states));
+	if (probe->endpoint == nullptr) {
+		return temp_endpoint_create(ctx, slot);
+	}
+	return ESP_OK;
+}
+
+/* ds18b20_trigger_temperature_conversion() sleeps for the worst case tCONV of the resolution. Issue the
+ * command directly instead and let the bus state machine poll for the end of the conversion. */
+static esp_err_t temp_start_conversion(void *arg, int slot, temp_resolution res)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
+	temp_probe *probe = &ctx->probes[slot];
+	esp_err_t err;
+	if (res != probe->programmed) {
+		err = ds18b20_set_resolution(probe->ds18b20, temp_ds18b20_resolution(res));
+		if (err != ESP_OK) {
+			return err;
+		}
+		probe->programmed = res;
+	}
+
+	uint64_t address = ctx->bus.probes[slot].address;
+	uint8_t cmd[2 + sizeof(address)];
+	cmd[0] = TEMP_CMD_MATCH_ROM;
+	memcpy(&cmd[1], &address, sizeof(address));
+	cmd[sizeof(cmd) - 1] = TEMP_CMD_CONVERT_T;
+
+	err = onewire_bus_reset(ctx->onewire);
+	if (err != ESP_OK) {
+		return err;
+	}
+	return onewire_bus_write_bytes(ctx->onewire, cmd, sizeof(cmd));
+}
+
+static esp_err_t temp_conversion_done(void *arg, int slot, bool *done)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
+	/* The DS18B20 answers read slots with 0 while converting */
+	uint8_t bit = 0;
+	esp_err_t err = onewire_bus_read_bit(ctx->onewire, &bit);
+	*done = bit != 0;
+	return err;
+}
 
-	// get temperature from sensors one by one
+static esp_err_t temp_read(void *arg, int slot, int16_t *centi)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
 	float temperature;
-	vTaskDelay(pdMS_TO_TICKS(200));
-	for (int i = 0; i < ds18b20_device_num; i++) {
-		ESP_ERROR_CHECK(ds18b20_trigger_temperature_conversion(temp_handle));
-		ESP_ERROR_CHECK(ds18b20_get_temperature(temp_handle, &temperature));
-		ESP_LOGI(__func__, "temperature read from DS18B20[%d]: %.2fC", i, temperature);
+	esp_err_t err = ds18b20_get_temperature(ctx->probes[slot].ds18b20, &temperature);
+	if (err == ESP_OK) {
+		*centi = (int16_t)(temperature * 100);
 	}
+	return err;
+}
 #else
-	ds18b20_device_handle_t temp_handle;
+static esp_err_t temp_search(void *arg, uint64_t *addresses, int max, int *found)
+{
+	addresses[0] = TEMP_FAMILY_DS18B20;
+	*found = 1;
+	return ESP_OK;
+}
+
+static esp_err_t temp_attach(void *arg, int slot, uint64_t address)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
+	if (ctx->probes[slot].endpoint == nullptr) {
+		return temp_endpoint_create(ctx, slot);
+	}
+	return ESP_OK;
+}
+
+static esp_err_t temp_start_conversion(void *arg, int slot, temp_resolution res)
+{
+	return ESP_OK;
+}
+
+static esp_err_t temp_conversion_done(void *arg, int slot, bool *done)
+{
+	*done = true;
+	return ESP_OK;
+}
+
+static esp_err_t temp_read(void *arg, int slot, int16_t *centi)
+{
+	*centi = (int16_t)fake_temp;
+	fake_temp += 50;
+	if (fake_temp > 4000) fake_temp = 2000;
+	return ESP_OK;
+}
 #endif
 
-	// temperature sensor endpoint
-	temperature_sensor::config_t matter_temp_config;
-	endpoint_t *temp_endpoint =
-	    temperature_sensor::create(node, &matter_temp_config, ENDPOINT_FLAG_NONE, &temp_handle);
-	if (temp_endpoint == nullptr) {
-		ESP_LOGE(__func__, "Failed to create a temperature endpoint");
-		abort();
-	}
-	uint16_t temp_endpoint_id = endpoint::get_id(temp_endpoint);
-	ESP_LOGI(__func__, "Temp created with endpoint_id %d", temp_endpoint_id);
-	// attribute_t *temp_attribute = attribute::get(temp_endpoint_id, TemperatureMeasurement::Id,
-	// TemperatureMeasurement::Attributes::MeasuredValue::Id);
-	s_ctx = {temp_handle, temp_endpoint_id};
-	esp_timer_create_args_t timer_args = {
-	    .callback = temp_sensor_reader,
-	    .arg = &s_ctx,
-	};
-	esp_timer_handle_t timer_handle;
-	if (ESP_OK != esp_timer_create(&timer_args, &timer_handle)) {
-	     ESP_LOGE(__func__, "Failed to create esp timer");
-	     abort();
+static const temp_bus_ops s_temp_bus_ops = {
+    .search = temp_search,
+    .attach = temp_attach,
+    .start_conversion = temp_start_conversion,
+    .conversion_done = temp_conversion_done,
+    .read = temp_read,
+    .on_reading = temp_on_reading,
+    .on_health = temp_on_health,
+};
+
+static void temp_schedule(struct sensor_reader_ctx *ctx, int64_t delay_us)
+{
+	if (delay_us == TEMP_BUS_DONE) {
+		return;
 	}
-	if (ESP_OK != esp_timer_start_periodic(timer_handle, /* 30s in us */ 30000000)) {
-	     ESP_LOGE(__func__, "Failed to start timer");
-	     abort();
+	/* a finished conversion keeps in the scratchpad until the next radio window; retries don't wait */
+	int64_t slack_us = ctx->bus.phase == TEMP_BUS_CONVERTING ? TEMP_READ_SLACK_US : 0;
+	radio_sched_defer(&ctx->step_job, delay_us, slack_us);
+}
+
+static void temp_bus_stepper(void *arg)
+{
+	struct sensor_reader_ctx *ctx = (struct sensor_reader_ctx *)arg;
+	uint32_t allocs = alloc_stats_count();
+	temp_schedule(ctx, temp_bus_step(&ctx->bus, esp_timer_get_time()));
+	allocs = alloc_stats_count() - allocs;
+	if (allocs != 0) {
+		ESP_LOGW(__func__, "Sensor loop performed %" PRIu32 " heap allocation(s)", allocs);
 	}
+}
+
+void temp_sensor_reader(void *arg)
+{
+	struct sensor_reader_ctx *s_ctx = (struct sensor_reader_ctx *)arg;
+	radio_sched_defer(&s_ctx->round_job, TEMP_SAMPLE_PERIOD_US, TEMP_SAMPLE_SLACK_US);
+	if (!s_ctx->steady_state) {
+		alloc_stats_watch_current_task();
+		s_ctx->steady_state = true;
+	}
+	if (temp_bus_busy(&s_ctx->bus)) {
+		ESP_LOGW(__func__, "Previous round of conversions still running");
+		return;
+	}
+	uint32_t allocs = alloc_stats_count();
+	temp_schedule(s_ctx, temp_bus_start_round(&s_ctx->bus, esp_timer_get_time()));
+	allocs = alloc_stats_count() - allocs;
+	/* a ROM rescan allocates its search iterator; only the plain sampling path has to stay off the heap */
+	if (allocs != 0 && s_ctx->bus.rounds_since_rescan != 0) {
+		ESP_LOGW(__func__, "Sensor loop performed %" PRIu32 " heap allocation(s)", allocs);
+	}
+}
+
+/* alarm limits are where the resolution matters most */
+static temp_policy temp_policy_with_rules(const temp_policy *configured)
+{
+	temp_policy policy = *configured;
+	if (policy.nr_thresholds == 0) {
+		for (int i = 0; i < s_ctx.nr_rules && policy.nr_thresholds < TEMP_POLICY_MAX_THRESHOLDS; i++) {
+			if (s_ctx.rules[i].kind == SENSOR_RULE_ABOVE || s_ctx.rules[i].kind == SENSOR_RULE_BELOW) {
+				policy.thresholds[policy.nr_thresholds++] = s_ctx.rules[i].limit;
+			}
+		}
+	}
+	return policy;
+}
+
+int matter_temp_init(node_t *node, const manifest::temp_probes *config)
+{
+	s_ctx.node = node;
+	if (config->nr_rules > SENSOR_RULES_MAX) {
+		ESP_LOGE(__func__, "%d alarm rules configured, at most %d are supported", (int)config->nr_rules,
+			 SENSOR_RULES_MAX);
+		return ESP_ERR_INVALID_ARG;
+	}
+	s_ctx.rules = config->rules;
+	s_ctx.nr_rules = config->nr_rules;
+
+	temp_policy policy = temp_policy_with_rules(&config->policy);
+	temp_bus_init(&s_ctx.bus, &s_temp_bus_ops, &s_ctx, &policy);
+	for (size_t i = 0; i < config->nr_probe_policies; i++) {
+		policy = temp_policy_with_rules(&config->probe_policies[i].policy);
+		if (temp_bus_set_probe_policy(&s_ctx.bus, config->probe_policies[i].address, &policy) != ESP_OK) {
+			ESP_LOGE(__func__, "%d probe policies configured, at most %d are supported",
+				 (int)config->nr_probe_policies, TEMP_BUS_MAX_PROBES);
+			return ESP_ERR_INVALID_ARG;
+		}
+	}
+
+	// install new 1-wire bus
+#if !TODO_FAKE_TEMP
+	onewire_bus_config_t bus_config = {
+	    .bus_gpio_num = config->gpio,
+	};
+	onewire_bus_rmt_config_t rmt_config = {
+	    .max_rx_bytes = 10, // 1byte ROM command + 8byte ROM number + 1byte device command
+	};
+	ESP_ERROR_CHECK(onewire_new_bus_rmt(&bus_config, &rmt_config, &s_ctx.onewire));
+	ESP_LOGI(__func__, "1-Wire bus installed on GPIO%d", config->gpio);
+#endif
+
+	/* A failed search only leaves the bus degraded; it is retried on the rescan schedule */
+	if (temp_bus_rescan(&s_ctx.bus) != ESP_OK) {
+		ESP_LOGW(__func__, "Initial 1-Wire search failed");
+	}
+	ESP_LOGI(__func__, "Searching done, %d DS18B20 device(s) found", s_ctx.bus.nr_probes);
+
+	s_ctx.step_job.fn = temp_bus_stepper;
+	s_ctx.step_job.arg = &s_ctx;
+	s_ctx.round_job.fn = temp_sensor_reader;
+	s_ctx.round_job.arg = &s_ctx;
+	radio_sched_defer(&s_ctx.round_job, TEMP_SAMPLE_PERIOD_US, TEMP_SAMPLE_SLACK_US);
 
 	return ESP_OK;
 }
@@ -0,0 +1,54 @@
+#include "temp_policy.h"
+#include <stdlib.h>
+
+/* LSB size in milli-degrees: 0.5, 0.25, 0.125 and 0.0625 degrees */
+static const uint16_t s_step_mdeg[TEMP_RES_COUNT] = {500, 250, 125, 63};
+
+/* Datasheet worst case tCONV */
+static const uint32_t s_max_conv_us[TEMP_RES_COUNT] = {93750, 187500, 375000, 750000};
+
+uint32_t temp_resolution_max_conv_us(temp_resolution res)
+{
+	return s_max_conv_us[res];
+}
+
+temp_resolution temp_policy_pick(const temp_policy *policy, bool have_last, int16_t last)
+{
+	if (have_last) {
+		for (int i = 0; i < policy->nr_thresholds; i++) {
+			if (abs(last - policy->thresholds[i]) <= policy->guard) {
+				return TEMP_RES_12B;
+			}
+		}
+	}
+
+	/* two LSBs per deadband, so a deadband crossing is never lost to quantization */
+	int32_t deadband_mdeg = (int32_t)policy->deadband * 10;
+	for (int res = TEMP_RES_9B; res < TEMP_RES_12B; res++) {
+		if (2 * s_step_mdeg[res] <= deadband_mdeg) {
+			return (temp_resolution)res;
+		}
+	}
+	return TEMP_RES_12B;
+}
+
+void temp_conv_stats_init(temp_conv_stats *stats)
+{
+	for (int res = 0; res < TEMP_RES_COUNT; res++) {
+		stats->expected_us[res] = s_max_conv_us[res];
+	}
+}
+
+uint32_t temp_conv_expected_us(const temp_conv_stats *stats, temp_resolution res)
+{
+	return stats->expected_us[res];
+}
+
+void temp_conv_learn(temp_conv_stats *stats, temp_resolution res, uint32_t measured_us)
+{
+	if (measured_us > s_max_conv_us[res]) {
+		measured_us = s_max_conv_us[res];
+	}
+	/* EWMA with 1/4 weight, quick enough to follow a probe warming up */
+	stats->expected_us[res] = stats->expected_us[res] - stats->expected_us[res] / 4 + measured_us / 4;
+}
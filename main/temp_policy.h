@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** DS18B20 resolutions, in the same order as ds18b20_resolution_t */
+enum temp_resolution {
+	TEMP_RES_9B,
+	TEMP_RES_10B,
+	TEMP_RES_11B,
+	TEMP_RES_12B,
+	TEMP_RES_COUNT,
+};
+
+#define TEMP_POLICY_MAX_THRESHOLDS 2
+
+/** Per-probe accuracy needs, all temperatures in centi-degrees like the Matter attribute */
+struct temp_policy {
+	int16_t deadband;	/* smallest change the endpoint has to resolve */
+	int16_t guard;		/* within this distance of a threshold the probe runs at full resolution */
+	uint8_t nr_thresholds;
+	int16_t thresholds[TEMP_POLICY_MAX_THRESHOLDS];
+};
+
+/** Learned conversion time per resolution, seeded with the datasheet maximum */
+struct temp_conv_stats {
+	uint32_t expected_us[TEMP_RES_COUNT];
+};
+
+uint32_t temp_resolution_max_conv_us(temp_resolution res);
+
+/* Coarsest resolution that still resolves the deadband, upgraded to 12 bit when last is near a threshold */
+temp_resolution temp_policy_pick(const temp_policy *policy, bool have_last, int16_t last);
+
+void temp_conv_stats_init(temp_conv_stats *stats);
+uint32_t temp_conv_expected_us(const temp_conv_stats *stats, temp_resolution res);
+void temp_conv_learn(temp_conv_stats *stats, temp_resolution res, uint32_t measured_us);
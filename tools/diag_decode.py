@@ -0,0 +1,49 @@
+#!/usr/bin/env python3
+"""Decode the "#T" trace records in a device console log (main/diag_log.h).
+
+Each record is a hex encoded little-endian struct: uint32 ms since boot, uint16 trace id, uint32 a,
+uint32 b. Other lines are passed through unchanged.
+
+    idf.py monitor | tee console.log
+    diag_decode.py console.log
+    diag_decode.py < console.log
+"""
+
+import argparse
+import re
+import struct
+import sys
+
+RECORD = struct.Struct('<IHII')
+RECORD_RE = re.compile(r'#T([0-9a-f]{%d})' % (2 * RECORD.size))
+
+# keep in sync with diag_trace_id in main/diag_log.h
+TRACES = {
+    1: ('temp', lambda a, b: f'probe {a}: {signed16(b) / 100:.2f} C'),
+}
+
+
+def signed16(value):
+    value &= 0xFFFF
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def decode(line):
+    match = RECORD_RE.search(line)
+    if not match:
+        return line
+    time_ms, trace_id, a, b = RECORD.unpack(bytes.fromhex(match.group(1)))
+    name, fmt = TRACES.get(trace_id, (f'trace {trace_id}', lambda a, b: f'a={a:#x} b={b:#x}'))
+    return f'{line[:match.start()]}T ({time_ms}) {name}: {fmt(a, b)}{line[match.end():]}'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r', errors='replace'), default=sys.stdin)
+    args = parser.parse_args()
+    for line in args.log:
+        sys.stdout.write(decode(line))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,121 @@
+#!/usr/bin/env python3
+"""Build a delta OTA image for the Matter OTA requestor (CONFIG_ENABLE_DELTA_OTA).
+
+The patch is a heatshrink-compressed detools patch from the firmware the fleet is running to the new
+firmware. It is preceded by the 64 byte header the device checks before applying anything: the delta
+magic and the SHA-256 of the base image, which has to match the running partition. The device applies
+it in a streaming way straight into the inactive OTA slot.
+
+Every patch is applied again here and compared with the new image before it is written.
+
+    ota_delta.py create --base build_v1/matter-home.bin --new build/matter-home.bin --patch patch.bin
+    ota_delta.py create ... --ota-image patch.ota --vendor-id 0xFFF1 --product-id 0x8000 \\
+        --version 2 --version-str 2.0
+
+Requires detools (pip install detools). Wrapping into a Matter OTA image uses ota_image_tool.py from the
+connectedhomeip tree under $ESP_MATTER_PATH.
+"""
+
+import argparse
+import io
+import os
+import struct
+import subprocess
+import sys
+
+try:
+    import detools
+except ImportError:
+    detools = None
+
+DELTA_MAGIC = 0xFCCDDE10
+HEADER_SIZE = 64
+DIGEST_SIZE = 32
+
+ESP_IMAGE_MAGIC = 0xE9
+# esp_image_header_t: 8 byte common header, then hash_appended as the last byte of the extended header
+ESP_IMAGE_HASH_APPENDED_OFFSET = 23
+
+
+def image_digest(image, name):
+    """SHA-256 esptool appends to an app image, which is what esp_partition_get_sha256() reports."""
+    if len(image) < ESP_IMAGE_HASH_APPENDED_OFFSET + 1 + DIGEST_SIZE or image[0] != ESP_IMAGE_MAGIC:
+        sys.exit(f'{name}: not an ESP app image')
+    if not image[ESP_IMAGE_HASH_APPENDED_OFFSET]:
+        sys.exit(f'{name}: image has no appended SHA-256, the device could not match it')
+    return image[-DIGEST_SIZE:]
+
+
+def delta_header(base, name):
+    header = struct.pack('<I', DELTA_MAGIC) + image_digest(base, name)
+    return header + bytes(HEADER_SIZE - len(header))
+
+
+def create_patch(base, new):
+    patch = io.BytesIO()
+    detools.create_patch(io.BytesIO(base), io.BytesIO(new), patch, compression='heatshrink')
+    return patch.getvalue()
+
+
+def verify_patch(base, new, patch):
+    applied = io.BytesIO()
+    detools.apply_patch(io.BytesIO(base), io.BytesIO(patch), applied)
+    if applied.getvalue() != new:
+        sys.exit('patch does not reproduce the new image')
+
+
+def wrap_ota_image(args, patch_path):
+    matter_sdk = os.path.join(os.environ.get('ESP_MATTER_PATH', ''), 'connectedhomeip', 'connectedhomeip')
+    tool = os.path.join(matter_sdk, 'src', 'app', 'ota_image_tool.py')
+    if not os.path.isfile(tool):
+        sys.exit(f'{tool} not found, set ESP_MATTER_PATH')
+    subprocess.run([sys.executable, tool, 'create',
+                    '-v', args.vendor_id, '-p', args.product_id,
+                    '-vn', str(args.version), '-vs', args.version_str,
+                    '-da', 'sha256', patch_path, args.ota_image], check=True)
+
+
+def cmd_create(args):
+    if detools is None:
+        sys.exit('detools is not installed: pip install detools')
+    with open(args.base, 'rb') as f:
+        base = f.read()
+    with open(args.new, 'rb') as f:
+        new = f.read()
+
+    header = delta_header(base, args.base)
+    image_digest(new, args.new)
+
+    patch = create_patch(base, new)
+    verify_patch(base, new, patch)
+
+    with open(args.patch, 'wb') as f:
+        f.write(header + patch)
+    print(f'{args.patch}: {HEADER_SIZE + len(patch)} bytes, '
+          f'{100 * (HEADER_SIZE + len(patch)) / len(new):.1f}% of the full image')
+
+    if args.ota_image:
+        wrap_ota_image(args, args.patch)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    create = sub.add_parser('create', help='create and verify a delta image')
+    create.add_argument('--base', required=True, help='app image the devices are running')
+    create.add_argument('--new', required=True, help='app image to update to')
+    create.add_argument('--patch', required=True, help='output delta image')
+    create.add_argument('--ota-image', help='also wrap the delta image into this Matter OTA image')
+    create.add_argument('--vendor-id', default='0xFFF1')
+    create.add_argument('--product-id', default='0x8000')
+    create.add_argument('--version', type=int, default=1)
+    create.add_argument('--version-str', default='1.0')
+    create.set_defaults(func=cmd_create)
+
+    args = parser.parse_args()
+    args.func(args)
+
+
+if __name__ == '__main__':
+    main()
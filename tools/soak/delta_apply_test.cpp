@@ -0,0 +1,142 @@
+/* Host test for the streaming delta applier the device runs: the detools C patcher with heatshrink, as
+ * esp_delta_ota builds it. Applies an ota_delta.py image to its base in fixed-size chunks, the way OTA
+ * blocks arrive, and checks the result byte for byte and that applying never touches the heap.
+ *
+ *     delta_apply_test BASE DELTA NEW [CHUNK]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "soak_host.h"
+#include "test_check.h"
+
+extern "C" {
+#include "detools.h"
+}
+
+/* the header tools/ota_delta.py writes: magic, SHA-256 of the base image, zero padding */
+#define DELTA_MAGIC 0xFCCDDE10
+#define DELTA_HEADER_SIZE 64
+#define DELTA_DIGEST_SIZE 32
+/* what the applier may keep between blocks, whatever the image size */
+#define DELTA_APPLY_STATE_MAX 4096
+
+/* heap.cpp reports to the heap hooks, like CONFIG_HEAP_USE_HOOKS on the device */
+extern "C" void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+}
+
+extern "C" void esp_heap_trace_free_hook(void *ptr)
+{
+}
+
+struct delta_apply_io {
+	const std::vector<uint8_t> *base;
+	size_t base_offset;
+	std::vector<uint8_t> *out;
+	size_t out_size;
+};
+
+static int delta_read_base(void *arg, uint8_t *buf, size_t size)
+{
+	delta_apply_io *io = (delta_apply_io *)arg;
+	if (io->base_offset + size > io->base->size()) {
+		return -1;
+	}
+	memcpy(buf, io->base->data() + io->base_offset, size);
+	io->base_offset += size;
+	return 0;
+}
+
+static int delta_seek_base(void *arg, int offset)
+{
+	delta_apply_io *io = (delta_apply_io *)arg;
+	if ((int64_t)io->base_offset + offset < 0 || io->base_offset + offset > io->base->size()) {
+		return -1;
+	}
+	io->base_offset += offset;
+	return 0;
+}
+
+static int delta_write_new(void *arg, const uint8_t *buf, size_t size)
+{
+	delta_apply_io *io = (delta_apply_io *)arg;
+	/* the output is sized up front, so writing does not allocate either */
+	if (io->out_size + size > io->out->size()) {
+		return -1;
+	}
+	memcpy(io->out->data() + io->out_size, buf, size);
+	io->out_size += size;
+	return 0;
+}
+
+static bool read_file(const char *path, std::vector<uint8_t> *data)
+{
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		perror(path);
+		return false;
+	}
+	uint8_t buf[4096];
+	size_t n;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		data->insert(data->end(), buf, buf + n);
+	}
+	fclose(f);
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 4) {
+		fprintf(stderr, "usage: %s BASE DELTA NEW [CHUNK]\n", argv[0]);
+		return 2;
+	}
+	std::vector<uint8_t> base, delta, expected;
+	if (!read_file(argv[1], &base) || !read_file(argv[2], &delta) || !read_file(argv[3], &expected)) {
+		return 2;
+	}
+	size_t chunk = argc > 4 ? strtoul(argv[4], NULL, 0) : 1024;
+
+	/* what the device checks before it erases anything */
+	uint32_t magic;
+	CHECK(delta.size() > DELTA_HEADER_SIZE);
+	memcpy(&magic, delta.data(), sizeof(magic));
+	CHECK(magic == DELTA_MAGIC);
+	CHECK(base.size() > DELTA_DIGEST_SIZE &&
+	      memcmp(delta.data() + 4, base.data() + base.size() - DELTA_DIGEST_SIZE, DELTA_DIGEST_SIZE) == 0);
+	if (s_failures != 0) {
+		return test_result("delta_apply");
+	}
+
+	std::vector<uint8_t> out(expected.size());
+	delta_apply_io io = {&base, 0, &out, 0};
+	static detools_apply_patch_t patcher;
+	printf("applier state: %zu bytes, %zu byte blocks\n", sizeof(patcher), chunk);
+	CHECK(sizeof(patcher) <= DELTA_APPLY_STATE_MAX);
+
+	uint64_t allocs = soak_host_heap().allocs;
+	size_t patch_size = delta.size() - DELTA_HEADER_SIZE;
+	int res = detools_apply_patch_init(&patcher, delta_read_base, delta_seek_base, patch_size, delta_write_new,
+					   &io);
+	for (size_t offset = 0; res == 0 && offset < patch_size; offset += chunk) {
+		size_t size = patch_size - offset < chunk ? patch_size - offset : chunk;
+		res = detools_apply_patch_process(&patcher, delta.data() + DELTA_HEADER_SIZE + offset, size);
+	}
+	if (res == 0) {
+		res = detools_apply_patch_finalize(&patcher);
+	}
+	allocs = soak_host_heap().allocs - allocs;
+
+	if (res < 0) {
+		fprintf(stderr, "apply failed: %s\n", detools_error_as_string(res));
+	}
+	CHECK(res >= 0);
+	CHECK(allocs == 0);
+	CHECK(io.out_size == expected.size());
+	CHECK(out == expected);
+	return test_result("delta_apply");
+}
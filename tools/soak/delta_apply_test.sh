@@ -0,0 +1,26 @@
+#!/bin/sh
+# Builds a delta with tools/ota_delta.py from two sample app images and applies it with the C applier.
+#   tools/soak/delta_apply_test.sh build_soak/delta_apply_test
+# Exits 77 (skipped) when the detools Python package is missing.
+set -eu
+apply=${1:?usage: delta_apply_test.sh path/to/delta_apply_test}
+tools=$(cd "$(dirname "$0")/.." && pwd)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+python3 -c 'import detools' 2>/dev/null || { echo "detools is not installed"; exit 77; }
+python3 - "$tools" "$tmp" <<'PY'
+import os
+import sys
+sys.path.insert(0, sys.argv[1])
+from test_ota_delta import sample_images
+base, new = sample_images()
+for name, data in (('base', base), ('new', new)):
+    with open(os.path.join(sys.argv[2], name + '.bin'), 'wb') as f:
+        f.write(data)
+PY
+python3 "$tools/ota_delta.py" create --base "$tmp/base.bin" --new "$tmp/new.bin" --patch "$tmp/delta.bin"
+# one byte at a time, an odd size, and a BDX sized block
+for chunk in 1 61 1024; do
+	"$apply" "$tmp/base.bin" "$tmp/delta.bin" "$tmp/new.bin" $chunk
+done
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <stdint.h>
+
+void MatterReportingAttributeChangeCallback(uint16_t endpoint, uint32_t cluster_id, uint32_t attribute_id);
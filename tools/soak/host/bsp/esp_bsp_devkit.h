@@ -0,0 +1,36 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/* The board LED, recorded by the soak driver instead of driven */
+
+typedef struct led_indicator *led_indicator_handle_t;
+
+#define BSP_LED_NUM 1
+
+enum {
+	BSP_LED_ON,
+	BSP_LED_OFF,
+};
+
+typedef union {
+	struct {
+		uint32_t v : 8;
+		uint32_t s : 8;
+		uint32_t h : 9;
+		uint32_t i : 7;
+	};
+	uint32_t value;
+} led_indicator_ihsv_t;
+
+#define SET_IRGB(INDEX, R, G, B) ((uint32_t)(INDEX) << 24 | (uint32_t)(R) << 16 | (uint32_t)(G) << 8 | (B))
+
+esp_err_t bsp_led_indicator_create(led_indicator_handle_t handles[], void *config, int size);
+esp_err_t led_indicator_set_on_off(led_indicator_handle_t handle, bool on_off);
+uint32_t led_indicator_get_hsv(led_indicator_handle_t handle);
+esp_err_t led_indicator_set_hsv(led_indicator_handle_t handle, uint32_t ihsv_value);
+esp_err_t led_indicator_set_rgb(led_indicator_handle_t handle, uint32_t irgb_value);
+esp_err_t led_indicator_set_color_temperature(led_indicator_handle_t handle, uint32_t temperature);
+esp_err_t led_indicator_start(led_indicator_handle_t handle, int blink_type);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <inttypes.h>
+#include <stdio.h>
+
+/* set by soak -v; the firmware's log lines are silent otherwise */
+extern bool soak_log_verbose;
+int64_t esp_timer_get_time(void);
+
+#define SOAK_LOG(level, tag, format, ...)                                                              \
+	do {                                                                                           \
+		if (soak_log_verbose) {                                                                \
+			printf(level " (%lld) %s: " format "\n", (long long)(esp_timer_get_time() / 1000), \
+			       tag, ##__VA_ARGS__);                                                    \
+		}                                                                                      \
+	} while (0)
+
+#define ESP_LOGE(tag, format, ...) SOAK_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) SOAK_LOG("W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) SOAK_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do {} while (0)
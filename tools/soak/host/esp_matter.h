@@ -0,0 +1,282 @@
+#pragma once
+
+/* Host stand-in for the slice of esp-matter the application drivers use: an in-memory attribute store
+ * whose changes are reported to the soak driver's simulated controller. */
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <esp_err.h>
+#include <freertos/FreeRTOS.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define REMAP_TO_RANGE(value, from, to) ((value * to) / from)
+#define REMAP_TO_RANGE_INVERSE(value, factor) (factor / (value ? value : 1))
+
+#define ESP_MATTER_VAL_NULLABLE_BASE 0x80
+
+typedef enum {
+	ESP_MATTER_VAL_TYPE_INVALID = 0,
+	ESP_MATTER_VAL_TYPE_BOOLEAN = 1,
+	ESP_MATTER_VAL_TYPE_INTEGER = 2,
+	ESP_MATTER_VAL_TYPE_FLOAT = 3,
+	ESP_MATTER_VAL_TYPE_ARRAY = 4,
+	ESP_MATTER_VAL_TYPE_CHAR_STRING = 5,
+	ESP_MATTER_VAL_TYPE_OCTET_STRING = 6,
+	ESP_MATTER_VAL_TYPE_INT8 = 7,
+	ESP_MATTER_VAL_TYPE_UINT8 = 8,
+	ESP_MATTER_VAL_TYPE_INT16 = 9,
+	ESP_MATTER_VAL_TYPE_UINT16 = 10,
+	ESP_MATTER_VAL_TYPE_INT32 = 11,
+	ESP_MATTER_VAL_TYPE_UINT32 = 12,
+	ESP_MATTER_VAL_TYPE_INT64 = 13,
+	ESP_MATTER_VAL_TYPE_UINT64 = 14,
+	ESP_MATTER_VAL_TYPE_ENUM8 = 15,
+	ESP_MATTER_VAL_TYPE_BITMAP8 = 16,
+	ESP_MATTER_VAL_TYPE_BITMAP16 = 17,
+	ESP_MATTER_VAL_TYPE_BITMAP32 = 18,
+	ESP_MATTER_VAL_TYPE_NULLABLE_BOOLEAN = ESP_MATTER_VAL_TYPE_BOOLEAN + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_INTEGER = ESP_MATTER_VAL_TYPE_INTEGER + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_FLOAT = ESP_MATTER_VAL_TYPE_FLOAT + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_INT8 = ESP_MATTER_VAL_TYPE_INT8 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_UINT8 = ESP_MATTER_VAL_TYPE_UINT8 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_INT16 = ESP_MATTER_VAL_TYPE_INT16 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_UINT16 = ESP_MATTER_VAL_TYPE_UINT16 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_INT32 = ESP_MATTER_VAL_TYPE_INT32 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_UINT32 = ESP_MATTER_VAL_TYPE_UINT32 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_INT64 = ESP_MATTER_VAL_TYPE_INT64 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_UINT64 = ESP_MATTER_VAL_TYPE_UINT64 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_ENUM8 = ESP_MATTER_VAL_TYPE_ENUM8 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_BITMAP8 = ESP_MATTER_VAL_TYPE_BITMAP8 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_BITMAP16 = ESP_MATTER_VAL_TYPE_BITMAP16 + ESP_MATTER_VAL_NULLABLE_BASE,
+	ESP_MATTER_VAL_TYPE_NULLABLE_BITMAP32 = ESP_MATTER_VAL_TYPE_BITMAP32 + ESP_MATTER_VAL_NULLABLE_BASE,
+} esp_matter_val_type_t;
+
+typedef union {
+	bool b;
+	int i;
+	float f;
+	int8_t i8;
+	uint8_t u8;
+	int16_t i16;
+	uint16_t u16;
+	int32_t i32;
+	uint32_t u32;
+	int64_t i64;
+	uint64_t u64;
+	struct {
+		uint8_t *b;
+		uint16_t s;
+		uint16_t n;
+		uint16_t t;
+	} a;
+	void *p;
+} esp_matter_val_t;
+
+typedef struct {
+	esp_matter_val_type_t type;
+	esp_matter_val_t val;
+} esp_matter_attr_val_t;
+
+template <typename T> class nullable {
+public:
+	nullable() : val(null_value()), null(true) {}
+	nullable(std::nullptr_t) : nullable() {}
+	nullable(T value) : val(value), null(false) {}
+
+	bool is_null() const { return null; }
+	T value_or(T other) const { return null ? other : val; }
+
+	/* Matter's on-air null for a signed integer is its minimum */
+	static T null_value() { return std::is_signed<T>::value ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max(); }
+
+private:
+	T val;
+	bool null;
+};
+
+esp_matter_attr_val_t esp_matter_invalid(void *val);
+esp_matter_attr_val_t esp_matter_bool(bool val);
+esp_matter_attr_val_t esp_matter_uint8(uint8_t val);
+esp_matter_attr_val_t esp_matter_uint16(uint16_t val);
+esp_matter_attr_val_t esp_matter_enum8(uint8_t val);
+esp_matter_attr_val_t esp_matter_nullable_uint8(nullable<uint8_t> val);
+esp_matter_attr_val_t esp_matter_nullable_int16(nullable<int16_t> val);
+
+namespace chip {
+namespace app {
+namespace Clusters {
+
+namespace OnOff {
+inline constexpr uint32_t Id = 0x0006;
+namespace Attributes {
+namespace OnOff {
+inline constexpr uint32_t Id = 0x0000;
+} // namespace OnOff
+} // namespace Attributes
+} // namespace OnOff
+
+namespace LevelControl {
+inline constexpr uint32_t Id = 0x0008;
+namespace Attributes {
+namespace CurrentLevel {
+inline constexpr uint32_t Id = 0x0000;
+} // namespace CurrentLevel
+} // namespace Attributes
+} // namespace LevelControl
+
+namespace BooleanState {
+inline constexpr uint32_t Id = 0x0045;
+namespace Attributes {
+namespace StateValue {
+inline constexpr uint32_t Id = 0x0000;
+} // namespace StateValue
+} // namespace Attributes
+} // namespace BooleanState
+
+namespace ColorControl {
+inline constexpr uint32_t Id = 0x0300;
+enum class ColorMode : uint8_t {
+	kCurrentHueAndCurrentSaturation = 0,
+	kCurrentXAndCurrentY = 1,
+	kColorTemperature = 2,
+};
+namespace Attributes {
+namespace CurrentHue {
+inline constexpr uint32_t Id = 0x0000;
+}
+namespace CurrentSaturation {
+inline constexpr uint32_t Id = 0x0001;
+}
+namespace CurrentX {
+inline constexpr uint32_t Id = 0x0003;
+}
+namespace CurrentY {
+inline constexpr uint32_t Id = 0x0004;
+}
+namespace ColorTemperatureMireds {
+inline constexpr uint32_t Id = 0x0007;
+}
+namespace ColorMode {
+inline constexpr uint32_t Id = 0x0008;
+}
+namespace EnhancedColorMode {
+inline constexpr uint32_t Id = 0x4001;
+}
+} // namespace Attributes
+} // namespace ColorControl
+
+namespace TemperatureMeasurement {
+inline constexpr uint32_t Id = 0x0402;
+namespace Attributes {
+namespace MeasuredValue {
+inline constexpr uint32_t Id = 0x0000;
+} // namespace MeasuredValue
+} // namespace Attributes
+} // namespace TemperatureMeasurement
+
+} // namespace Clusters
+} // namespace app
+} // namespace chip
+
+namespace esp_matter {
+
+struct node_t;
+struct endpoint_t;
+struct cluster_t;
+struct attribute_t;
+
+enum {
+	ENDPOINT_FLAG_NONE = 0x00,
+};
+
+enum {
+	CLUSTER_FLAG_SERVER = 0x02,
+};
+
+bool is_started();
+
+namespace lock {
+typedef enum {
+	FAILED,
+	ALREADY_TAKEN,
+	SUCCESS,
+} status_t;
+
+status_t chip_stack_lock(uint32_t ticks_to_wait);
+esp_err_t chip_stack_unlock();
+} // namespace lock
+
+namespace attribute {
+typedef enum {
+	PRE_UPDATE,
+	POST_UPDATE,
+	READ,
+	WRITE,
+} callback_type_t;
+
+typedef esp_err_t (*callback_t)(callback_type_t type, uint16_t endpoint_id, uint32_t cluster_id,
+				uint32_t attribute_id, esp_matter_attr_val_t *val, void *priv_data);
+
+attribute_t *get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id);
+esp_err_t get_val(attribute_t *attribute, esp_matter_attr_val_t *val);
+esp_err_t set_val(attribute_t *attribute, esp_matter_attr_val_t *val);
+esp_err_t set_deferred_persistence(attribute_t *attribute);
+} // namespace attribute
+
+namespace endpoint {
+uint16_t get_id(endpoint_t *endpoint);
+void *get_priv_data(uint16_t endpoint_id);
+esp_err_t enable(endpoint_t *endpoint);
+esp_err_t destroy(node_t *node, endpoint_t *endpoint);
+
+namespace extended_color_light {
+typedef struct config {
+	struct {
+		bool on_off = false;
+		struct {
+			nullable<bool> start_up_on_off;
+		} lighting;
+	} on_off;
+	struct {
+		nullable<uint8_t> current_level = 0xFE;
+		nullable<uint8_t> on_level = 0xFE;
+		struct {
+			nullable<uint8_t> start_up_current_level;
+		} lighting;
+	} level_control;
+	struct {
+		uint8_t color_mode = 1;
+		uint8_t enhanced_color_mode = 1;
+		struct {
+			nullable<uint16_t> startup_color_temperature_mireds;
+		} color_temperature;
+	} color_control;
+} config_t;
+
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data);
+} // namespace extended_color_light
+
+namespace temperature_sensor {
+typedef struct config {
+	struct {
+		nullable<int16_t> measured_value;
+	} temperature_measurement;
+} config_t;
+
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data);
+} // namespace temperature_sensor
+} // namespace endpoint
+
+namespace cluster {
+namespace boolean_state {
+typedef struct config {
+	bool state_value = false;
+} config_t;
+
+cluster_t *create(endpoint_t *endpoint, config_t *config, uint8_t flags);
+} // namespace boolean_state
+} // namespace cluster
+
+} // namespace esp_matter
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <openthread/link.h>
+
+otInstance *esp_openthread_get_instance(void);
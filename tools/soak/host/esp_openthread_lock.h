@@ -0,0 +1,6 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+bool esp_openthread_lock_acquire(TickType_t block_ticks);
+void esp_openthread_lock_release(void);
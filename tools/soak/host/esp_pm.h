@@ -0,0 +1,17 @@
+#pragma once
+
+#include <esp_err.h>
+#include <stdint.h>
+
+typedef esp_err_t (*esp_pm_light_sleep_cb_t)(int64_t sleep_time_us, void *arg);
+
+typedef struct {
+	esp_pm_light_sleep_cb_t enter_cb;
+	esp_pm_light_sleep_cb_t exit_cb;
+	void *enter_cb_user_arg;
+	void *exit_cb_user_arg;
+	uint32_t enter_cb_prior;
+	uint32_t exit_cb_prior;
+} esp_pm_sleep_cbs_register_config_t;
+
+esp_err_t esp_pm_light_sleep_register_cbs(esp_pm_sleep_cbs_register_config_t *cbs_conf);
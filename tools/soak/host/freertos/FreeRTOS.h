@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdint.h>
+
+/* The soak driver is single threaded: critical sections and locks are no-ops */
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef struct {
+	int unused;
+} portMUX_TYPE;
+
+#define pdTRUE 1
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_SAFE(mux) ((void)(mux))
+#define portEXIT_CRITICAL_SAFE(mux) ((void)(mux))
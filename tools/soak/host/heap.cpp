@@ -0,0 +1,103 @@
+#include "soak_host.h"
+#include <errno.h>
+#include <malloc.h>
+#include <stdlib.h>
+
+/* Replaces the glibc allocator entry points, operator new included since libstdc++ allocates through
+ * malloc. Every allocation is counted and reported to the heap hook, as CONFIG_HEAP_USE_HOOKS does on the
+ * device, so alloc_stats sees host allocations too. */
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+
+void esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps);
+void esp_heap_trace_free_hook(void *ptr);
+}
+
+static soak_heap_stats s_heap;
+
+static void *soak_heap_alloced(void *ptr, size_t size)
+{
+	if (ptr != NULL) {
+		s_heap.allocs++;
+		s_heap.live_bytes += malloc_usable_size(ptr);
+		if (s_heap.live_bytes > s_heap.peak_bytes) {
+			s_heap.peak_bytes = s_heap.live_bytes;
+		}
+		esp_heap_trace_alloc_hook(ptr, size, 0);
+	}
+	return ptr;
+}
+
+static void soak_heap_freeing(void *ptr)
+{
+	if (ptr != NULL) {
+		s_heap.live_bytes -= malloc_usable_size(ptr);
+		esp_heap_trace_free_hook(ptr);
+	}
+}
+
+extern "C" void *malloc(size_t size)
+{
+	return soak_heap_alloced(__libc_malloc(size), size);
+}
+
+extern "C" void *calloc(size_t nmemb, size_t size)
+{
+	return soak_heap_alloced(__libc_calloc(nmemb, size), nmemb * size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+	size_t old_bytes = ptr != NULL ? malloc_usable_size(ptr) : 0;
+	void *moved = __libc_realloc(ptr, size);
+	if (moved == NULL && size != 0) {
+		/* ptr is left alone */
+		return NULL;
+	}
+	if (ptr != NULL) {
+		s_heap.live_bytes -= old_bytes;
+		esp_heap_trace_free_hook(ptr);
+	}
+	return soak_heap_alloced(moved, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+	return soak_heap_alloced(__libc_memalign(alignment, size), size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+	return memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+	void *p = memalign(alignment, size);
+	if (p == NULL) {
+		return ENOMEM;
+	}
+	*ptr = p;
+	return 0;
+}
+
+extern "C" void free(void *ptr)
+{
+	soak_heap_freeing(ptr);
+	__libc_free(ptr);
+}
+
+soak_heap_stats soak_host_heap(void)
+{
+	return s_heap;
+}
+
+void soak_host_heap_reset_peak(void)
+{
+	s_heap.peak_bytes = s_heap.live_bytes;
+}
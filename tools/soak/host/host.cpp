@@ -0,0 +1,536 @@
+#include "soak_host.h"
+#include "app/reporting/reporting.h"
+#include "bsp/esp_bsp_devkit.h"
+#include "diag_log.h"
+#include "esp_log.h"
+#include "esp_openthread.h"
+#include "esp_openthread_lock.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <string.h>
+
+using namespace esp_matter;
+using namespace chip::app::Clusters;
+
+/* Fixed tables, so nothing on the host side allocates once the scenario runs */
+#define SOAK_MAX_TIMERS 4
+#define SOAK_MAX_SLEEP_CBS 4
+#define SOAK_MAX_ENDPOINTS 8
+#define SOAK_MAX_ATTRIBUTES 64
+
+bool soak_log_verbose;
+
+struct esp_timer {
+	esp_timer_cb_t callback;
+	void *arg;
+	int64_t due_us;
+	bool armed;
+};
+
+namespace esp_matter {
+struct node_t {
+	int unused;
+};
+
+struct endpoint_t {
+	uint16_t id;
+	soak_endpoint_kind kind;
+	void *priv_data;
+};
+
+struct cluster_t {
+	int unused;
+};
+
+struct attribute_t {
+	endpoint_t *endpoint;
+	uint32_t cluster_id;
+	uint32_t attribute_id;
+	esp_matter_attr_val_t val;
+	bool deferred;
+};
+} // namespace esp_matter
+
+struct led_indicator {
+	soak_led_state state;
+};
+
+static int64_t s_now_us;
+static bool s_started;
+static uint32_t s_poll_period_ms = 1000;
+static uint32_t s_traces;
+
+static struct esp_timer s_timers[SOAK_MAX_TIMERS];
+static int s_nr_timers;
+static esp_pm_light_sleep_cb_t s_sleep_exit_cbs[SOAK_MAX_SLEEP_CBS];
+static void *s_sleep_exit_args[SOAK_MAX_SLEEP_CBS];
+static int s_nr_sleep_exit_cbs;
+
+static node_t s_node;
+static endpoint_t s_endpoints[SOAK_MAX_ENDPOINTS];
+static int s_nr_endpoints;
+static cluster_t s_cluster;
+static attribute_t s_attributes[SOAK_MAX_ATTRIBUTES];
+static int s_nr_attributes;
+static attribute::callback_t s_attribute_cb;
+static soak_host_change_cb_t s_change_cb;
+
+static led_indicator s_led;
+
+/* ESP-IDF and FreeRTOS */
+
+int64_t esp_timer_get_time(void)
+{
+	return s_now_us;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *create_args, esp_timer_handle_t *out_handle)
+{
+	if (s_nr_timers == SOAK_MAX_TIMERS) {
+		return ESP_ERR_NO_MEM;
+	}
+	esp_timer_handle_t timer = &s_timers[s_nr_timers++];
+	timer->callback = create_args->callback;
+	timer->arg = create_args->arg;
+	*out_handle = timer;
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+	if (timer->armed) {
+		return ESP_ERR_INVALID_STATE;
+	}
+	timer->due_us = s_now_us + timeout_us;
+	timer->armed = true;
+	return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+	if (!timer->armed) {
+		return ESP_ERR_INVALID_STATE;
+	}
+	timer->armed = false;
+	return ESP_OK;
+}
+
+esp_err_t esp_pm_light_sleep_register_cbs(esp_pm_sleep_cbs_register_config_t *cbs_conf)
+{
+	if (cbs_conf->exit_cb != NULL) {
+		if (s_nr_sleep_exit_cbs == SOAK_MAX_SLEEP_CBS) {
+			return ESP_ERR_NO_MEM;
+		}
+		s_sleep_exit_cbs[s_nr_sleep_exit_cbs] = cbs_conf->exit_cb;
+		s_sleep_exit_args[s_nr_sleep_exit_cbs++] = cbs_conf->exit_cb_user_arg;
+	}
+	return ESP_OK;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return &s_node;
+}
+
+/* OpenThread */
+
+otInstance *esp_openthread_get_instance(void)
+{
+	return NULL;
+}
+
+bool esp_openthread_lock_acquire(TickType_t block_ticks)
+{
+	return true;
+}
+
+void esp_openthread_lock_release(void)
+{
+}
+
+uint32_t otLinkGetPollPeriod(otInstance *instance)
+{
+	return s_poll_period_ms;
+}
+
+uint32_t otLinkGetCslPeriod(otInstance *instance)
+{
+	return 0;
+}
+
+/* Board LED */
+
+esp_err_t bsp_led_indicator_create(led_indicator_handle_t handles[], void *config, int size)
+{
+	handles[0] = &s_led;
+	return ESP_OK;
+}
+
+esp_err_t led_indicator_set_on_off(led_indicator_handle_t handle, bool on_off)
+{
+	handle->state.on = on_off;
+	handle->state.updates++;
+	return ESP_OK;
+}
+
+uint32_t led_indicator_get_hsv(led_indicator_handle_t handle)
+{
+	return handle->state.hsv;
+}
+
+esp_err_t led_indicator_set_hsv(led_indicator_handle_t handle, uint32_t ihsv_value)
+{
+	handle->state.hsv = ihsv_value;
+	handle->state.updates++;
+	return ESP_OK;
+}
+
+esp_err_t led_indicator_set_rgb(led_indicator_handle_t handle, uint32_t irgb_value)
+{
+	handle->state.updates++;
+	return ESP_OK;
+}
+
+esp_err_t led_indicator_set_color_temperature(led_indicator_handle_t handle, uint32_t temperature)
+{
+	handle->state.color_temperature = temperature;
+	handle->state.updates++;
+	return ESP_OK;
+}
+
+esp_err_t led_indicator_start(led_indicator_handle_t handle, int blink_type)
+{
+	return ESP_OK;
+}
+
+/* Diagnostics: trace records are only counted */
+
+void diag_trace(diag_trace_id id, uint32_t a, uint32_t b)
+{
+	s_traces++;
+}
+
+/* esp-matter */
+
+static esp_matter_attr_val_t soak_val(esp_matter_val_type_t type)
+{
+	esp_matter_attr_val_t val;
+	memset(&val, 0, sizeof(val));
+	val.type = type;
+	return val;
+}
+
+esp_matter_attr_val_t esp_matter_invalid(void *val)
+{
+	return soak_val(ESP_MATTER_VAL_TYPE_INVALID);
+}
+
+esp_matter_attr_val_t esp_matter_bool(bool b)
+{
+	esp_matter_attr_val_t val = soak_val(ESP_MATTER_VAL_TYPE_BOOLEAN);
+	val.val.b = b;
+	return val;
+}
+
+esp_matter_attr_val_t esp_matter_uint8(uint8_t u8)
+{
+	esp_matter_attr_val_t val = soak_val(ESP_MATTER_VAL_TYPE_UINT8);
+	val.val.u8 = u8;
+	return val;
+}
+
+esp_matter_attr_val_t esp_matter_uint16(uint16_t u16)
+{
+	esp_matter_attr_val_t val = soak_val(ESP_MATTER_VAL_TYPE_UINT16);
+	val.val.u16 = u16;
+	return val;
+}
+
+esp_matter_attr_val_t esp_matter_enum8(uint8_t u8)
+{
+	esp_matter_attr_val_t val = soak_val(ESP_MATTER_VAL_TYPE_ENUM8);
+	val.val.u8 = u8;
+	return val;
+}
+
+esp_matter_attr_val_t esp_matter_nullable_uint8(nullable<uint8_t> u8)
+{
+	esp_matter_attr_val_t val = soak_val(ESP_MATTER_VAL_TYPE_NULLABLE_UINT8);
+	val.val.u8 = u8.value_or(nullable<uint8_t>::null_value());
+	return val;
+}
+
+esp_matter_attr_val_t esp_matter_nullable_int16(nullable<int16_t> i16)
+{
+	esp_matter_attr_val_t val = soak_val(ESP_MATTER_VAL_TYPE_NULLABLE_INT16);
+	val.val.i16 = i16.value_or(nullable<int16_t>::null_value());
+	return val;
+}
+
+static endpoint_t *soak_endpoint_add(soak_endpoint_kind kind, void *priv_data)
+{
+	if (s_nr_endpoints == SOAK_MAX_ENDPOINTS) {
+		return nullptr;
+	}
+	endpoint_t *endpoint = &s_endpoints[s_nr_endpoints++];
+	/* endpoint 0 is the root node */
+	endpoint->id = s_nr_endpoints;
+	endpoint->kind = kind;
+	endpoint->priv_data = priv_data;
+	return endpoint;
+}
+
+static void soak_attribute_add(endpoint_t *endpoint, uint32_t cluster_id, uint32_t attribute_id,
+			       esp_matter_attr_val_t val)
+{
+	if (s_nr_attributes == SOAK_MAX_ATTRIBUTES) {
+		fprintf(stderr, "soak: attribute table full\n");
+		abort();
+	}
+	attribute_t *attribute = &s_attributes[s_nr_attributes++];
+	attribute->endpoint = endpoint;
+	attribute->cluster_id = cluster_id;
+	attribute->attribute_id = attribute_id;
+	attribute->val = val;
+}
+
+namespace esp_matter {
+
+bool is_started()
+{
+	return s_started;
+}
+
+namespace lock {
+status_t chip_stack_lock(uint32_t ticks_to_wait)
+{
+	return SUCCESS;
+}
+
+esp_err_t chip_stack_unlock()
+{
+	return ESP_OK;
+}
+} // namespace lock
+
+namespace attribute {
+attribute_t *get(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id)
+{
+	for (int i = 0; i < s_nr_attributes; i++) {
+		attribute_t *attribute = &s_attributes[i];
+		if (attribute->endpoint->id == endpoint_id && attribute->cluster_id == cluster_id &&
+		    attribute->attribute_id == attribute_id) {
+			return attribute;
+		}
+	}
+	return nullptr;
+}
+
+esp_err_t get_val(attribute_t *attribute, esp_matter_attr_val_t *val)
+{
+	if (attribute == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	*val = attribute->val;
+	return ESP_OK;
+}
+
+esp_err_t set_val(attribute_t *attribute, esp_matter_attr_val_t *val)
+{
+	if (attribute == nullptr || val->type != attribute->val.type) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	attribute->val = *val;
+	return ESP_OK;
+}
+
+esp_err_t set_deferred_persistence(attribute_t *attribute)
+{
+	if (attribute == nullptr) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	attribute->deferred = true;
+	return ESP_OK;
+}
+} // namespace attribute
+
+namespace endpoint {
+uint16_t get_id(endpoint_t *endpoint)
+{
+	return endpoint->id;
+}
+
+void *get_priv_data(uint16_t endpoint_id)
+{
+	for (int i = 0; i < s_nr_endpoints; i++) {
+		if (s_endpoints[i].id == endpoint_id) {
+			return s_endpoints[i].priv_data;
+		}
+	}
+	return nullptr;
+}
+
+esp_err_t enable(endpoint_t *endpoint)
+{
+	return ESP_OK;
+}
+
+/* the fixed tables keep the slot, the endpoint just stops being referenced */
+esp_err_t destroy(node_t *node, endpoint_t *endpoint)
+{
+	return ESP_OK;
+}
+
+namespace extended_color_light {
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data)
+{
+	endpoint_t *endpoint = soak_endpoint_add(SOAK_ENDPOINT_LIGHT, priv_data);
+	if (endpoint == nullptr) {
+		return nullptr;
+	}
+	soak_attribute_add(endpoint, OnOff::Id, OnOff::Attributes::OnOff::Id, esp_matter_bool(config->on_off.on_off));
+	soak_attribute_add(endpoint, LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id,
+			   esp_matter_nullable_uint8(config->level_control.current_level));
+	soak_attribute_add(endpoint, ColorControl::Id, ColorControl::Attributes::ColorMode::Id,
+			   esp_matter_enum8(config->color_control.color_mode));
+	soak_attribute_add(endpoint, ColorControl::Id, ColorControl::Attributes::EnhancedColorMode::Id,
+			   esp_matter_enum8(config->color_control.enhanced_color_mode));
+	soak_attribute_add(endpoint, ColorControl::Id, ColorControl::Attributes::CurrentHue::Id, esp_matter_uint8(0));
+	soak_attribute_add(endpoint, ColorControl::Id, ColorControl::Attributes::CurrentSaturation::Id,
+			   esp_matter_uint8(0));
+	soak_attribute_add(endpoint, ColorControl::Id, ColorControl::Attributes::CurrentX::Id,
+			   esp_matter_uint16(0x616b));
+	soak_attribute_add(endpoint, ColorControl::Id, ColorControl::Attributes::CurrentY::Id,
+			   esp_matter_uint16(0x607d));
+	soak_attribute_add(endpoint, ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id,
+			   esp_matter_uint16(0x00fa));
+	return endpoint;
+}
+} // namespace extended_color_light
+
+namespace temperature_sensor {
+endpoint_t *create(node_t *node, config_t *config, uint8_t flags, void *priv_data)
+{
+	endpoint_t *endpoint = soak_endpoint_add(SOAK_ENDPOINT_TEMP, priv_data);
+	if (endpoint == nullptr) {
+		return nullptr;
+	}
+	soak_attribute_add(endpoint, TemperatureMeasurement::Id, TemperatureMeasurement::Attributes::MeasuredValue::Id,
+			   esp_matter_nullable_int16(config->temperature_measurement.measured_value));
+	return endpoint;
+}
+} // namespace temperature_sensor
+} // namespace endpoint
+
+namespace cluster {
+namespace boolean_state {
+cluster_t *create(endpoint_t *endpoint, config_t *config, uint8_t flags)
+{
+	soak_attribute_add(endpoint, BooleanState::Id, BooleanState::Attributes::StateValue::Id,
+			   esp_matter_bool(config->state_value));
+	return &s_cluster;
+}
+} // namespace boolean_state
+} // namespace cluster
+
+} // namespace esp_matter
+
+void MatterReportingAttributeChangeCallback(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id)
+{
+	attribute_t *attribute = attribute::get(endpoint_id, cluster_id, attribute_id);
+	if (attribute != nullptr && s_change_cb != NULL) {
+		s_change_cb(attribute->endpoint->kind, endpoint_id, cluster_id, attribute_id);
+	}
+}
+
+/* Soak driver side */
+
+void soak_host_set_time(int64_t now_us)
+{
+	s_now_us = now_us;
+}
+
+int64_t soak_host_timer_due(void)
+{
+	int64_t due_us = INT64_MAX;
+	for (int i = 0; i < s_nr_timers; i++) {
+		if (s_timers[i].armed && s_timers[i].due_us < due_us) {
+			due_us = s_timers[i].due_us;
+		}
+	}
+	return due_us;
+}
+
+void soak_host_fire_timers(void)
+{
+	for (int i = 0; i < s_nr_timers; i++) {
+		struct esp_timer *timer = &s_timers[i];
+		if (timer->armed && timer->due_us <= s_now_us) {
+			timer->armed = false;
+			timer->callback(timer->arg);
+		}
+	}
+}
+
+void soak_host_wake(void)
+{
+	for (int i = 0; i < s_nr_sleep_exit_cbs; i++) {
+		s_sleep_exit_cbs[i](0, s_sleep_exit_args[i]);
+	}
+}
+
+void soak_host_set_poll_period(uint32_t period_ms)
+{
+	s_poll_period_ms = period_ms;
+}
+
+void soak_host_set_started(bool started)
+{
+	s_started = started;
+}
+
+void soak_host_set_attribute_callback(attribute::callback_t cb)
+{
+	s_attribute_cb = cb;
+}
+
+esp_err_t soak_host_write(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id,
+			  esp_matter_attr_val_t *val)
+{
+	attribute_t *attribute = attribute::get(endpoint_id, cluster_id, attribute_id);
+	if (attribute == nullptr) {
+		return ESP_ERR_NOT_FOUND;
+	}
+	esp_err_t err = s_attribute_cb(attribute::PRE_UPDATE, endpoint_id, cluster_id, attribute_id, val,
+				       attribute->endpoint->priv_data);
+	if (err != ESP_OK) {
+		return err;
+	}
+	bool changed = memcmp(&attribute->val, val, sizeof(*val)) != 0;
+	err = attribute::set_val(attribute, val);
+	if (err == ESP_OK && changed) {
+		MatterReportingAttributeChangeCallback(endpoint_id, cluster_id, attribute_id);
+	}
+	return err;
+}
+
+void soak_host_set_change_callback(soak_host_change_cb_t cb)
+{
+	s_change_cb = cb;
+}
+
+node_t *soak_host_node(void)
+{
+	return &s_node;
+}
+
+const soak_led_state *soak_host_led(void)
+{
+	return &s_led.state;
+}
+
+uint32_t soak_host_traces(void)
+{
+	return s_traces;
+}
@@ -0,0 +1,136 @@
+/* A 1-Wire bus with one DS18B20. The probe reads whatever temperature the scenario last set, at the
+ * resolution in its scratchpad, and takes the typical rather than the worst case tCONV, so the driver's
+ * learned conversion times and resolution policy run as they do on the board. */
+
+#include "ds18b20.h"
+#include "esp_timer.h"
+#include "soak_host.h"
+#include <math.h>
+#include <string.h>
+
+#define SOAK_PROBE_ADDRESS 0x3C0000A1B2C3D428ULL
+#define SOAK_CMD_MATCH_ROM 0x55
+#define SOAK_CMD_CONVERT_T 0x44
+
+struct onewire_bus_t {
+	int unused;
+};
+
+struct onewire_device_iter_t {
+	bool done;
+};
+
+struct ds18b20_device_t {
+	ds18b20_resolution_t resolution;
+	int16_t centi;
+	/* the temperature latched by the last conversion, in 1/16 degrees */
+	int16_t scratchpad;
+	int64_t converted_us;
+};
+
+static onewire_bus_t s_bus;
+static onewire_device_iter_t s_iter;
+static ds18b20_device_t s_probe = {
+    .resolution = DS18B20_RESOLUTION_12B,
+    .centi = 2000,
+    /* the power-on value, 85 degrees */
+    .scratchpad = 85 * 16,
+};
+
+void soak_host_set_probe_temp(int16_t centi)
+{
+	s_probe.centi = centi;
+}
+
+/* 75% of the datasheet maximum of 93.75 ms per resolution bit */
+static int64_t soak_tconv_us(ds18b20_resolution_t resolution)
+{
+	return 93750LL * 3 / 4 << (int)resolution;
+}
+
+esp_err_t onewire_new_bus_rmt(const onewire_bus_config_t *bus_config, const onewire_bus_rmt_config_t *rmt_config,
+			      onewire_bus_handle_t *ret_bus)
+{
+	*ret_bus = &s_bus;
+	return ESP_OK;
+}
+
+esp_err_t onewire_bus_reset(onewire_bus_handle_t bus)
+{
+	return ESP_OK;
+}
+
+esp_err_t onewire_bus_write_bytes(onewire_bus_handle_t bus, const uint8_t *tx_data, uint8_t tx_data_size)
+{
+	uint64_t address;
+	if (tx_data_size != 2 + sizeof(address) || tx_data[0] != SOAK_CMD_MATCH_ROM ||
+	    tx_data[tx_data_size - 1] != SOAK_CMD_CONVERT_T) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	memcpy(&address, &tx_data[1], sizeof(address));
+	if (address != SOAK_PROBE_ADDRESS) {
+		/* nobody answers, the read slots stay low */
+		return ESP_OK;
+	}
+	/* the low bits below the resolution read as zero */
+	int step = 1 << (DS18B20_RESOLUTION_12B - s_probe.resolution);
+	s_probe.scratchpad = (int16_t)(floor(s_probe.centi * 16 / 100.0 / step) * step);
+	s_probe.converted_us = esp_timer_get_time() + soak_tconv_us(s_probe.resolution);
+	return ESP_OK;
+}
+
+esp_err_t onewire_bus_read_bit(onewire_bus_handle_t bus, uint8_t *rx_bit)
+{
+	*rx_bit = esp_timer_get_time() >= s_probe.converted_us;
+	return ESP_OK;
+}
+
+esp_err_t onewire_new_device_iter(onewire_bus_handle_t bus, onewire_device_iter_handle_t *ret_iter)
+{
+	s_iter.done = false;
+	*ret_iter = &s_iter;
+	return ESP_OK;
+}
+
+esp_err_t onewire_device_iter_get_next(onewire_device_iter_handle_t iter, onewire_device_t *dev)
+{
+	if (iter->done) {
+		return ESP_ERR_NOT_FOUND;
+	}
+	iter->done = true;
+	dev->bus = &s_bus;
+	dev->address = SOAK_PROBE_ADDRESS;
+	return ESP_OK;
+}
+
+esp_err_t onewire_del_device_iter(onewire_device_iter_handle_t iter)
+{
+	return ESP_OK;
+}
+
+esp_err_t ds18b20_new_device(onewire_device_t *device, const ds18b20_config_t *config,
+			     ds18b20_device_handle_t *ret_ds18b20)
+{
+	if (device->address != SOAK_PROBE_ADDRESS) {
+		return ESP_ERR_NOT_FOUND;
+	}
+	*ret_ds18b20 = &s_probe;
+	return ESP_OK;
+}
+
+esp_err_t ds18b20_del_device(ds18b20_device_handle_t ds18b20)
+{
+	return ESP_OK;
+}
+
+esp_err_t ds18b20_set_resolution(ds18b20_device_handle_t ds18b20, ds18b20_resolution_t resolution)
+{
+	ds18b20->resolution = resolution;
+	return ESP_OK;
+}
+
+esp_err_t ds18b20_get_temperature(ds18b20_device_handle_t ds18b20, float *temperature)
+{
+	*temperature = ds18b20->scratchpad / 16.0f;
+	return ESP_OK;
+}
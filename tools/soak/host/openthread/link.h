@@ -0,0 +1,10 @@
+#pragma once
+
+#include <stdint.h>
+
+/* Data poll period of the simulated parent link, set per scenario */
+
+typedef struct otInstance otInstance;
+
+uint32_t otLinkGetPollPeriod(otInstance *instance);
+uint32_t otLinkGetCslPeriod(otInstance *instance);
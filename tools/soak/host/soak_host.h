@@ -0,0 +1,64 @@
+#pragma once
+
+/* What the stand-in platform exposes to the soak driver: the simulated clock, the esp_timer queue, light
+ * sleep exits, the parent's poll period, controller writes, the attribute change feed and the probe on
+ * the 1-Wire bus. */
+
+#include <esp_err.h>
+#include <esp_matter.h>
+#include <stdint.h>
+
+enum soak_endpoint_kind {
+	SOAK_ENDPOINT_LIGHT,
+	SOAK_ENDPOINT_TEMP,
+};
+
+struct soak_heap_stats {
+	/* successful allocations, malloc through operator new */
+	uint64_t allocs;
+	int64_t live_bytes;
+	/* most live bytes since the last soak_host_heap_reset_peak() */
+	int64_t peak_bytes;
+};
+
+struct soak_led_state {
+	bool on;
+	uint32_t hsv;
+	uint32_t color_temperature;
+	/* calls into the LED driver, i.e. strip refreshes on the board */
+	uint32_t updates;
+};
+
+void soak_host_set_time(int64_t now_us);
+
+/* earliest armed esp_timer, INT64_MAX when none */
+int64_t soak_host_timer_due(void);
+/* runs every timer due at the current time */
+void soak_host_fire_timers(void);
+
+/* the chip left light sleep: runs the registered exit callbacks */
+void soak_host_wake(void);
+
+void soak_host_set_poll_period(uint32_t period_ms);
+void soak_host_set_started(bool started);
+
+/* What the Matter stack does for a write or command from the controller: the application gets a
+ * PRE_UPDATE callback, then the value is stored and reported if it changed */
+void soak_host_set_attribute_callback(esp_matter::attribute::callback_t cb);
+esp_err_t soak_host_write(uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id,
+			  esp_matter_attr_val_t *val);
+
+typedef void (*soak_host_change_cb_t)(soak_endpoint_kind kind, uint16_t endpoint_id, uint32_t cluster_id,
+				      uint32_t attribute_id);
+void soak_host_set_change_callback(soak_host_change_cb_t cb);
+
+/* the temperature the DS18B20 reads from its next conversion on */
+void soak_host_set_probe_temp(int16_t centi);
+
+esp_matter::node_t *soak_host_node(void);
+const soak_led_state *soak_host_led(void);
+uint32_t soak_host_traces(void);
+
+/* host heap, counted by the allocator wrappers in heap.cpp */
+soak_heap_stats soak_host_heap(void);
+void soak_host_heap_reset_peak(void);
@@ -0,0 +1,11 @@
+#!/bin/sh
+# Runs every scenario against baseline.txt; exits non-zero if any of them regressed.
+#   tools/soak/run.sh build_soak/soak
+set -u
+soak=${1:?usage: run.sh path/to/soak}
+dir=$(dirname "$0")
+status=0
+for trace in "$dir"/scenarios/*.trace; do
+	"$soak" --baseline "$dir/baseline.txt" "$trace" || status=1
+done
+exit $status
@@ -0,0 +1,118 @@
+/* Host test for the local alarm rules (main/sensor_rules.cpp) */
+
+#include "sensor_rules.h"
+#include "test_check.h"
+
+#define SECOND_US (1000LL * 1000)
+
+struct rule_run {
+	sensor_rule rule;
+	sensor_rule_state state;
+	int64_t now_us;
+};
+
+/* one sample every period_s, returns whether the rule is active afterwards */
+static bool feed(rule_run *run, int16_t value, int period_s = 30)
+{
+	run->now_us += period_s * SECOND_US;
+	return sensor_rule_eval(&run->rule, &run->state, value, run->now_us);
+}
+
+static void test_above_hysteresis(void)
+{
+	rule_run run = {{.kind = SENSOR_RULE_ABOVE, .limit = 3500, .hysteresis = 100}};
+	CHECK(!feed(&run, 3500));
+	CHECK(feed(&run, 3501));
+	/* stays raised down to limit - hysteresis, exclusive */
+	CHECK(feed(&run, 3401));
+	CHECK(!feed(&run, 3400));
+	/* and needs the limit again, not just the hysteresis band, to come back */
+	CHECK(!feed(&run, 3450));
+	CHECK(!feed(&run, 3500));
+	CHECK(feed(&run, 3600));
+}
+
+static void test_below_hysteresis(void)
+{
+	rule_run run = {{.kind = SENSOR_RULE_BELOW, .limit = 500, .hysteresis = 100}};
+	CHECK(!feed(&run, 500));
+	CHECK(feed(&run, 499));
+	CHECK(feed(&run, 599));
+	CHECK(!feed(&run, 600));
+	CHECK(!feed(&run, 550));
+	CHECK(feed(&run, -1000));
+}
+
+static void test_rate(void)
+{
+	rule_run run = {{.kind = SENSOR_RULE_RATE, .limit = 300}};
+	/* nothing to compare the first sample with */
+	CHECK(!feed(&run, 2000));
+	/* exactly the limit per minute is fine, one centi-degree more is not */
+	CHECK(!feed(&run, 2300, 60));
+	CHECK(feed(&run, 2601, 60));
+	/* the rate is per minute whatever the sample spacing: 150 in 30 s is 300 per minute */
+	CHECK(!feed(&run, 2751, 30));
+	CHECK(feed(&run, 2902, 30));
+	/* falling counts as well */
+	CHECK(feed(&run, 2000, 60));
+	/* a sample without time passing keeps the previous state */
+	CHECK(feed(&run, 2000, 0));
+	CHECK(!feed(&run, 2000, 60));
+	CHECK(!feed(&run, 2000, 0));
+}
+
+static void test_stuck(void)
+{
+	rule_run run = {{.kind = SENSOR_RULE_STUCK, .limit = 0, .count = 3}};
+	CHECK(!feed(&run, 2000));
+	CHECK(!feed(&run, 2000));
+	CHECK(feed(&run, 2000));
+	CHECK(feed(&run, 2000));
+	/* any change restarts the count */
+	CHECK(!feed(&run, 2025));
+	CHECK(!feed(&run, 2025));
+	CHECK(feed(&run, 2025));
+
+	/* limit is the largest step between consecutive samples that still counts as the same */
+	rule_run drift = {{.kind = SENSOR_RULE_STUCK, .limit = 10, .count = 3}};
+	CHECK(!feed(&drift, 2000));
+	CHECK(!feed(&drift, 2010));
+	CHECK(feed(&drift, 2000));
+	CHECK(!feed(&drift, 2011));
+
+	rule_run single = {{.kind = SENSOR_RULE_STUCK, .limit = 0, .count = 1}};
+	CHECK(feed(&single, 2000));
+
+	/* count 0 disables the rule */
+	rule_run disabled = {{.kind = SENSOR_RULE_STUCK, .limit = 0, .count = 0}};
+	for (int i = 0; i < 100; i++) {
+		CHECK(!feed(&disabled, 2000));
+	}
+}
+
+static void test_rules_any_active(void)
+{
+	const sensor_rule rules[] = {
+	    {.kind = SENSOR_RULE_ABOVE, .limit = 3500, .hysteresis = 100},
+	    {.kind = SENSOR_RULE_BELOW, .limit = 500, .hysteresis = 100},
+	};
+	sensor_rule_state states[2] = {};
+	CHECK(!sensor_rules_eval(rules, states, 2, 2000, 0));
+	CHECK(sensor_rules_eval(rules, states, 2, 400, 30 * SECOND_US));
+	CHECK(!states[0].active && states[1].active);
+	CHECK(sensor_rules_eval(rules, states, 2, 3600, 60 * SECOND_US));
+	CHECK(states[0].active && !states[1].active);
+	/* every rule sees every sample, also once an earlier one is active */
+	CHECK(states[1].last == 3600);
+}
+
+int main(void)
+{
+	test_above_hysteresis();
+	test_below_hysteresis();
+	test_rate();
+	test_stuck();
+	test_rules_any_active();
+	return test_result("sensor_rules");
+}
@@ -0,0 +1,511 @@
+/* Soak and power regression benchmark. Replays a recorded controller trace against the application
+ * drivers on the host and models what the device would do on a Thread sleepy link:
+ *
+ * - commands wait at the parent until the next data poll, which is the command latency reported
+ * - the chip wakes for polls, for its own esp_timers and to send subscription reports; wakeups closer
+ *   together than the awake window are one wakeup
+ * - subscriptions report dirty attributes at most every min interval and keep alive every max interval
+ *
+ * Time is simulated, so a day of traffic runs in well under a second and every metric except the
+ * handler time is deterministic. */
+
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <fstream>
+#include <inttypes.h>
+#include <sstream>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soak_host.h"
+
+#include <app_priv.h>
+#include <app_drivers.h>
+#include <radio_sched.h>
+#include APP_SKU_MANIFEST
+
+using namespace esp_matter;
+using namespace chip::app::Clusters;
+
+#define SOAK_MAX_PENDING 256
+#define SOAK_LATENCY_BUCKETS 10000	/* 1 ms each */
+#define SOAK_HANDLER_BUCKETS 10000	/* 1 us each */
+
+uint16_t light_endpoint_id = 0;
+
+enum soak_command_kind {
+	SOAK_CMD_ON,
+	SOAK_CMD_OFF,
+	SOAK_CMD_TOGGLE,
+	SOAK_CMD_LEVEL,
+	SOAK_CMD_HUE,
+	SOAK_CMD_SAT,
+	SOAK_CMD_CTEMP,
+	SOAK_CMD_TEMP,
+};
+
+struct soak_command {
+	int64_t at_us;
+	soak_command_kind kind;
+	int32_t value;
+};
+
+struct soak_subscription {
+	soak_endpoint_kind kind;
+	int64_t min_us;
+	int64_t max_us;
+	bool dirty;
+	int64_t dirty_us;
+	int64_t last_report_us;
+};
+
+struct soak_scenario {
+	std::string name;
+	uint32_t poll_ms = 1000;
+	/* ICD active mode: faster polling for active_ms after a message */
+	uint32_t active_poll_ms = 200;
+	uint32_t active_ms = 0;
+	uint32_t awake_ms = 5;
+	int64_t duration_us = 3600LL * 1000 * 1000;
+	int64_t loop_us = 0;
+	std::vector<soak_command> commands;
+	std::vector<soak_subscription> subscriptions;
+};
+
+struct soak_pending {
+	int64_t sent_us;
+	const soak_command *command;
+};
+
+struct soak_metrics {
+	uint32_t commands;
+	uint32_t latency_ms[SOAK_LATENCY_BUCKETS];
+	uint32_t handler_us[SOAK_HANDLER_BUCKETS];
+	uint32_t reports;
+	uint32_t keepalives;
+	uint32_t attr_changes;
+	/* BooleanState changes, i.e. temperature alarms raised or cleared */
+	uint32_t alarm_changes;
+	uint32_t wakeups;
+	uint32_t polls;
+	soak_heap_stats heap_start;
+	soak_heap_stats heap_end;
+};
+
+struct soak_metric {
+	const char *name;
+	double value;
+};
+
+static soak_scenario s_scenario;
+static soak_metrics s_metrics;
+static soak_pending s_pending[SOAK_MAX_PENDING];
+static uint32_t s_pending_head, s_pending_tail;
+static int64_t s_awake_until_us = INT64_MIN;
+
+static void soak_on_change(soak_endpoint_kind kind, uint16_t endpoint_id, uint32_t cluster_id, uint32_t attribute_id)
+{
+	int64_t now_us = esp_timer_get_time();
+	s_metrics.attr_changes++;
+	if (cluster_id == BooleanState::Id) {
+		s_metrics.alarm_changes++;
+	}
+	for (soak_subscription &sub : s_scenario.subscriptions) {
+		if (sub.kind == kind && !sub.dirty) {
+			sub.dirty = true;
+			sub.dirty_us = now_us;
+		}
+	}
+}
+
+static void soak_wake(int64_t now_us)
+{
+	int64_t window_us = (int64_t)s_scenario.awake_ms * 1000;
+	if (now_us < s_awake_until_us) {
+		s_awake_until_us = std::max(s_awake_until_us, now_us + window_us);
+		return;
+	}
+	s_metrics.wakeups++;
+	s_awake_until_us = now_us + window_us;
+	soak_host_wake();
+}
+
+static void soak_write(uint32_t cluster_id, uint32_t attribute_id, esp_matter_attr_val_t val)
+{
+	esp_err_t err = soak_host_write(light_endpoint_id, cluster_id, attribute_id, &val);
+	if (err != ESP_OK) {
+		fprintf(stderr, "%s: write 0x%" PRIx32 "/0x%" PRIx32 " failed, err:%d\n", s_scenario.name.c_str(),
+			cluster_id, attribute_id, err);
+		exit(2);
+	}
+}
+
+static void soak_execute(const soak_command *command)
+{
+	esp_matter_attr_val_t val = esp_matter_invalid(NULL);
+	switch (command->kind) {
+	case SOAK_CMD_ON:
+	case SOAK_CMD_OFF:
+		soak_write(OnOff::Id, OnOff::Attributes::OnOff::Id, esp_matter_bool(command->kind == SOAK_CMD_ON));
+		break;
+	case SOAK_CMD_TOGGLE:
+		attribute::get_val(attribute::get(light_endpoint_id, OnOff::Id, OnOff::Attributes::OnOff::Id), &val);
+		soak_write(OnOff::Id, OnOff::Attributes::OnOff::Id, esp_matter_bool(!val.val.b));
+		break;
+	case SOAK_CMD_LEVEL:
+		soak_write(LevelControl::Id, LevelControl::Attributes::CurrentLevel::Id,
+			   esp_matter_nullable_uint8(command->value));
+		break;
+	case SOAK_CMD_HUE:
+		soak_write(ColorControl::Id, ColorControl::Attributes::ColorMode::Id,
+			   esp_matter_enum8((uint8_t)ColorControl::ColorMode::kCurrentHueAndCurrentSaturation));
+		soak_write(ColorControl::Id, ColorControl::Attributes::CurrentHue::Id, esp_matter_uint8(command->value));
+		break;
+	case SOAK_CMD_SAT:
+		soak_write(ColorControl::Id, ColorControl::Attributes::ColorMode::Id,
+			   esp_matter_enum8((uint8_t)ColorControl::ColorMode::kCurrentHueAndCurrentSaturation));
+		soak_write(ColorControl::Id, ColorControl::Attributes::CurrentSaturation::Id,
+			   esp_matter_uint8(command->value));
+		break;
+	case SOAK_CMD_CTEMP:
+		soak_write(ColorControl::Id, ColorControl::Attributes::ColorMode::Id,
+			   esp_matter_enum8((uint8_t)ColorControl::ColorMode::kColorTemperature));
+		soak_write(ColorControl::Id, ColorControl::Attributes::ColorTemperatureMireds::Id,
+			   esp_matter_uint16(command->value));
+		break;
+	case SOAK_CMD_TEMP:
+		break;
+	}
+}
+
+static void soak_deliver(int64_t now_us)
+{
+	for (; s_pending_tail != s_pending_head; s_pending_tail++) {
+		const soak_pending *pending = &s_pending[s_pending_tail % SOAK_MAX_PENDING];
+		auto start = std::chrono::steady_clock::now();
+		soak_execute(pending->command);
+		auto handler_us =
+		    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+		int64_t latency_ms = (now_us - pending->sent_us) / 1000;
+		s_metrics.commands++;
+		s_metrics.latency_ms[std::min<int64_t>(latency_ms, SOAK_LATENCY_BUCKETS - 1)]++;
+		s_metrics.handler_us[std::min<int64_t>(handler_us, SOAK_HANDLER_BUCKETS - 1)]++;
+	}
+}
+
+static int64_t soak_report_due(const soak_subscription &sub)
+{
+	if (sub.dirty) {
+		return std::max(sub.last_report_us + sub.min_us, sub.dirty_us);
+	}
+	return sub.last_report_us + sub.max_us;
+}
+
+static void soak_run(void)
+{
+	const soak_scenario &sc = s_scenario;
+	size_t next_command = 0;
+	int64_t loop_offset_us = 0;
+	int64_t next_poll_us = (int64_t)sc.poll_ms * 1000;
+	int64_t active_until_us = INT64_MIN;
+
+	soak_host_heap_reset_peak();
+	s_metrics.heap_start = soak_host_heap();
+
+	for (;;) {
+		int64_t command_us = INT64_MAX;
+		if (next_command == sc.commands.size() && sc.loop_us > 0 && !sc.commands.empty()) {
+			next_command = 0;
+			loop_offset_us += sc.loop_us;
+		}
+		if (next_command < sc.commands.size()) {
+			command_us = sc.commands[next_command].at_us + loop_offset_us;
+		}
+		int64_t timer_us = soak_host_timer_due();
+		int64_t report_us = INT64_MAX;
+		soak_subscription *report_sub = nullptr;
+		for (soak_subscription &sub : s_scenario.subscriptions) {
+			int64_t due_us = soak_report_due(sub);
+			if (due_us < report_us) {
+				report_us = due_us;
+				report_sub = &sub;
+			}
+		}
+
+		int64_t now_us = std::min({command_us, timer_us, report_us, next_poll_us});
+		if (now_us >= sc.duration_us) {
+			break;
+		}
+		soak_host_set_time(now_us);
+
+		if (timer_us == now_us) {
+			soak_wake(now_us);
+			soak_host_fire_timers();
+		} else if (next_poll_us == now_us) {
+			soak_wake(now_us);
+			s_metrics.polls++;
+			if (s_pending_head != s_pending_tail) {
+				soak_deliver(now_us);
+				active_until_us = now_us + (int64_t)sc.active_ms * 1000;
+			}
+			uint32_t period_ms = now_us < active_until_us ? sc.active_poll_ms : sc.poll_ms;
+			soak_host_set_poll_period(period_ms);
+			next_poll_us = now_us + (int64_t)period_ms * 1000;
+		} else if (command_us == now_us) {
+			const soak_command *command = &sc.commands[next_command++];
+			if (command->kind == SOAK_CMD_TEMP) {
+				/* the environment, not a message */
+				soak_host_set_probe_temp(command->value);
+			} else {
+				if (s_pending_head - s_pending_tail == SOAK_MAX_PENDING) {
+					fprintf(stderr, "%s: more than %d commands queued at the parent\n", sc.name.c_str(),
+						SOAK_MAX_PENDING);
+					exit(2);
+				}
+				s_pending[s_pending_head++ % SOAK_MAX_PENDING] = {now_us, command};
+			}
+		} else {
+			soak_wake(now_us);
+			if (report_sub->dirty) {
+				s_metrics.reports++;
+			} else {
+				s_metrics.keepalives++;
+			}
+			report_sub->dirty = false;
+			report_sub->last_report_us = now_us;
+		}
+	}
+	s_metrics.heap_end = soak_host_heap();
+}
+
+static bool soak_parse_command(const std::string &word, soak_command_kind *kind)
+{
+	static const struct {
+		const char *name;
+		soak_command_kind kind;
+	} names[] = {
+	    {"on", SOAK_CMD_ON},   {"off", SOAK_CMD_OFF}, {"toggle", SOAK_CMD_TOGGLE}, {"level", SOAK_CMD_LEVEL},
+	    {"hue", SOAK_CMD_HUE}, {"sat", SOAK_CMD_SAT}, {"ctemp", SOAK_CMD_CTEMP},   {"temp", SOAK_CMD_TEMP},
+	};
+	for (const auto &name : names) {
+		if (word == name.name) {
+			*kind = name.kind;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool soak_load(const char *path, soak_scenario *sc)
+{
+	std::ifstream in(path);
+	if (!in) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return false;
+	}
+	std::string base = path;
+	base = base.substr(base.find_last_of('/') + 1);
+	sc->name = base.substr(0, base.find('.'));
+
+	std::string line;
+	for (int nr = 1; std::getline(in, line); nr++) {
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string word;
+		if (!(words >> word)) {
+			continue;
+		}
+		bool ok = true;
+		if (word == "poll") {
+			ok = !!(words >> sc->poll_ms);
+		} else if (word == "active_poll") {
+			ok = !!(words >> sc->active_poll_ms);
+		} else if (word == "active_ms") {
+			ok = !!(words >> sc->active_ms);
+		} else if (word == "awake_ms") {
+			ok = !!(words >> sc->awake_ms);
+		} else if (word == "duration") {
+			int64_t seconds;
+			ok = !!(words >> seconds);
+			sc->duration_us = seconds * 1000 * 1000;
+		} else if (word == "loop") {
+			int64_t ms;
+			ok = !!(words >> ms);
+			sc->loop_us = ms * 1000;
+		} else if (word == "subscribe") {
+			std::string kind;
+			int64_t min_s, max_s;
+			ok = (words >> kind >> min_s >> max_s) && (kind == "light" || kind == "temp") && max_s > 0;
+			soak_subscription sub = {};
+			sub.kind = kind == "light" ? SOAK_ENDPOINT_LIGHT : SOAK_ENDPOINT_TEMP;
+			sub.min_us = min_s * 1000 * 1000;
+			sub.max_us = max_s * 1000 * 1000;
+			sc->subscriptions.push_back(sub);
+		} else {
+			soak_command command = {};
+			int64_t at_ms;
+			std::string name;
+			ok = (std::istringstream(word) >> at_ms) && (words >> name) &&
+			     soak_parse_command(name, &command.kind);
+			if (ok && command.kind != SOAK_CMD_ON && command.kind != SOAK_CMD_OFF &&
+			    command.kind != SOAK_CMD_TOGGLE) {
+				ok = !!(words >> command.value);
+			}
+			command.at_us = at_ms * 1000;
+			ok = ok && (sc->commands.empty() || command.at_us >= sc->commands.back().at_us);
+			sc->commands.push_back(command);
+		}
+		if (!ok) {
+			fprintf(stderr, "%s:%d: cannot parse \"%s\"\n", path, nr, line.c_str());
+			return false;
+		}
+	}
+	if (sc->loop_us > 0 && !sc->commands.empty() && sc->commands.back().at_us >= sc->loop_us) {
+		fprintf(stderr, "%s: commands run past the loop period\n", path);
+		return false;
+	}
+	return true;
+}
+
+static double soak_percentile(const uint32_t *buckets, int nr_buckets, uint32_t total, double p)
+{
+	if (total == 0) {
+		return 0;
+	}
+	uint64_t rank = (uint64_t)(p * total + 0.999999);
+	uint64_t seen = 0;
+	for (int i = 0; i < nr_buckets; i++) {
+		seen += buckets[i];
+		if (seen >= rank) {
+			return i;
+		}
+	}
+	return nr_buckets - 1;
+}
+
+static std::vector<soak_metric> soak_collect(void)
+{
+	const soak_metrics &m = s_metrics;
+	double hours = s_scenario.duration_us / 3600e6;
+	return {
+	    {"commands", (double)m.commands},
+	    {"latency_p50_ms", soak_percentile(m.latency_ms, SOAK_LATENCY_BUCKETS, m.commands, 0.50)},
+	    {"latency_p90_ms", soak_percentile(m.latency_ms, SOAK_LATENCY_BUCKETS, m.commands, 0.90)},
+	    {"latency_p99_ms", soak_percentile(m.latency_ms, SOAK_LATENCY_BUCKETS, m.commands, 0.99)},
+	    {"latency_max_ms", soak_percentile(m.latency_ms, SOAK_LATENCY_BUCKETS, m.commands, 1.0)},
+	    {"handler_p99_us", soak_percentile(m.handler_us, SOAK_HANDLER_BUCKETS, m.commands, 0.99)},
+	    {"attr_changes", (double)m.attr_changes},
+	    {"alarm_changes", (double)m.alarm_changes},
+	    {"reports", (double)m.reports},
+	    {"keepalives", (double)m.keepalives},
+	    {"reports_per_hour", (m.reports + m.keepalives) / hours},
+	    {"led_updates", (double)soak_host_led()->updates},
+	    {"traces", (double)soak_host_traces()},
+	    {"wakeups_per_hour", m.wakeups / hours},
+	    {"heap_allocs", (double)(m.heap_end.allocs - m.heap_start.allocs)},
+	    {"heap_peak_bytes", (double)(m.heap_end.peak_bytes - m.heap_start.live_bytes)},
+	};
+}
+
+/* Baseline lines: <scenario> <metric> <max|min> <limit>. Returns the number of violated limits. */
+static int soak_check(const char *path, const std::vector<soak_metric> &metrics)
+{
+	std::ifstream in(path);
+	if (!in) {
+		fprintf(stderr, "%s: %s\n", path, strerror(errno));
+		return 1;
+	}
+	int failures = 0, checked = 0;
+	std::string line;
+	for (int nr = 1; std::getline(in, line); nr++) {
+		line = line.substr(0, line.find('#'));
+		std::istringstream words(line);
+		std::string scenario, name, bound;
+		double limit;
+		if (!(words >> scenario)) {
+			continue;
+		}
+		if (!(words >> name >> bound >> limit) || (bound != "max" && bound != "min")) {
+			fprintf(stderr, "%s:%d: cannot parse \"%s\"\n", path, nr, line.c_str());
+			return failures + 1;
+		}
+		if (scenario != s_scenario.name) {
+			continue;
+		}
+		auto metric = std::find_if(metrics.begin(), metrics.end(),
+					   [&](const soak_metric &m) { return name == m.name; });
+		if (metric == metrics.end()) {
+			fprintf(stderr, "%s:%d: unknown metric %s\n", path, nr, name.c_str());
+			return failures + 1;
+		}
+		checked++;
+		if (bound == "max" ? metric->value > limit : metric->value < limit) {
+			printf("FAIL %s %s %.1f, %s %.1f\n", scenario.c_str(), name.c_str(), metric->value, bound.c_str(),
+			       limit);
+			failures++;
+		}
+	}
+	if (checked == 0) {
+		printf("FAIL %s has no baseline in %s\n", s_scenario.name.c_str(), path);
+		return 1;
+	}
+	return failures;
+}
+
+static void soak_usage(const char *argv0)
+{
+	fprintf(stderr, "usage: %s [-v] [--baseline FILE] [--print-baseline] SCENARIO.trace\n", argv0);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *baseline = nullptr;
+	const char *trace = nullptr;
+	bool print_baseline = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-v") == 0) {
+			soak_log_verbose = true;
+		} else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+			baseline = argv[++i];
+		} else if (strcmp(argv[i], "--print-baseline") == 0) {
+			print_baseline = true;
+		} else if (argv[i][0] != '-' && trace == nullptr) {
+			trace = argv[i];
+		} else {
+			soak_usage(argv[0]);
+		}
+	}
+	if (trace == nullptr || !soak_load(trace, &s_scenario)) {
+		soak_usage(argv[0]);
+	}
+
+	/* bring the device up the way app_main() does */
+	soak_host_set_poll_period(s_scenario.poll_ms);
+	soak_host_set_attribute_callback(app_attribute_update_cb);
+	soak_host_set_change_callback(soak_on_change);
+	ESP_ERROR_CHECK(radio_sched_init());
+	ESP_ERROR_CHECK(manifest::device_init(soak_host_node(), k_device));
+	soak_host_set_started(true);
+	ESP_ERROR_CHECK(manifest::device_start(k_device));
+
+	soak_run();
+
+	std::vector<soak_metric> metrics = soak_collect();
+	if (print_baseline) {
+		for (const soak_metric &metric : metrics) {
+			printf("%-16s %-28s max %.1f\n", s_scenario.name.c_str(), metric.name, metric.value);
+		}
+	} else {
+		printf("%s: %.1f h simulated\n", s_scenario.name.c_str(), s_scenario.duration_us / 3600e6);
+		for (const soak_metric &metric : metrics) {
+			printf("  %-28s %10.1f\n", metric.name, metric.value);
+		}
+	}
+	return baseline != nullptr && soak_check(baseline, metrics) != 0 ? 1 : 0;
+}
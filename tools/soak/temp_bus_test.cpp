@@ -0,0 +1,379 @@
+/* Host test for the 1-Wire retry and rescan state machine (main/temp_bus.cpp) against a mock bus that
+ * injects CRC errors, conversion timeouts, missing presence pulses and ROM changes. */
+
+#include <string.h>
+#include <vector>
+
+#include "temp_bus.h"
+#include "test_check.h"
+
+#define ADDR_A 0x0000000000000a28ULL
+#define ADDR_B 0x0000000000000b28ULL
+#define ADDR_C 0x0000000000000c28ULL
+#define ADDR_D 0x0000000000000d28ULL
+
+struct mock_health_event {
+	int slot;
+	temp_probe_health health;
+};
+
+/* Faults are keyed by ROM address, so they follow a probe across slots */
+struct mock_probe {
+	uint64_t address;
+	esp_err_t start_err;	/* returned by start_conversion, ESP_ERR_NOT_FOUND for no presence pulse */
+	esp_err_t read_err;	/* returned by read, ESP_ERR_INVALID_CRC for a bad scratchpad */
+	bool never_done;	/* conversion never finishes */
+	int16_t centi;
+	int starts;
+	int reads;
+};
+
+struct mock_bus {
+	mock_probe probes[8];
+	int nr_probes;
+	bool present[8];
+	int searches;
+	int round;
+	std::vector<int> search_rounds;
+	std::vector<int> attach_slots;
+	std::vector<mock_health_event> health;
+	uint64_t slot_address[TEMP_BUS_MAX_PROBES];
+};
+
+static mock_probe *mock_find(mock_bus *m, uint64_t address)
+{
+	for (int i = 0; i < m->nr_probes; i++) {
+		if (m->probes[i].address == address) {
+			return &m->probes[i];
+		}
+	}
+	return nullptr;
+}
+
+static mock_probe *mock_add(mock_bus *m, uint64_t address)
+{
+	mock_probe *p = &m->probes[m->nr_probes];
+	memset(p, 0, sizeof(*p));
+	p->address = address;
+	p->centi = 2150;
+	m->present[m->nr_probes++] = true;
+	return p;
+}
+
+static void mock_set_present(mock_bus *m, uint64_t address, bool present)
+{
+	m->present[mock_find(m, address) - m->probes] = present;
+}
+
+static esp_err_t mock_search(void *ctx, uint64_t *addresses, int max, int *found)
+{
+	mock_bus *m = (mock_bus *)ctx;
+	m->searches++;
+	m->search_rounds.push_back(m->round);
+	*found = 0;
+	for (int i = 0; i < m->nr_probes && *found < max; i++) {
+		if (m->present[i]) {
+			addresses[(*found)++] = m->probes[i].address;
+		}
+	}
+	return ESP_OK;
+}
+
+static esp_err_t mock_attach(void *ctx, int slot, uint64_t address)
+{
+	mock_bus *m = (mock_bus *)ctx;
+	m->attach_slots.push_back(slot);
+	m->slot_address[slot] = address;
+	return ESP_OK;
+}
+
+static esp_err_t mock_start_conversion(void *ctx, int slot, temp_resolution res)
+{
+	mock_bus *m = (mock_bus *)ctx;
+	mock_probe *p = mock_find(m, m->slot_address[slot]);
+	p->starts++;
+	return p->start_err;
+}
+
+static esp_err_t mock_conversion_done(void *ctx, int slot, bool *done)
+{
+	mock_bus *m = (mock_bus *)ctx;
+	*done = !mock_find(m, m->slot_address[slot])->never_done;
+	return ESP_OK;
+}
+
+static esp_err_t mock_read(void *ctx, int slot, int16_t *centi)
+{
+	mock_bus *m = (mock_bus *)ctx;
+	mock_probe *p = mock_find(m, m->slot_address[slot]);
+	p->reads++;
+	*centi = p->centi;
+	return p->read_err;
+}
+
+static void mock_on_reading(void *ctx, int slot, int16_t centi)
+{
+}
+
+static void mock_on_health(void *ctx, int slot, temp_probe_health health)
+{
+	mock_bus *m = (mock_bus *)ctx;
+	m->health.push_back({slot, health});
+}
+
+static const temp_bus_ops s_mock_ops = {
+    .search = mock_search,
+    .attach = mock_attach,
+    .start_conversion = mock_start_conversion,
+    .conversion_done = mock_conversion_done,
+    .read = mock_read,
+    .on_reading = mock_on_reading,
+    .on_health = mock_on_health,
+};
+
+static const temp_policy s_policy = {
+    .deadband = 50,
+    .guard = 100,
+};
+
+static void setup(temp_bus *bus, mock_bus *m)
+{
+	temp_bus_init(bus, &s_mock_ops, m, &s_policy);
+	CHECK(temp_bus_rescan(bus) == ESP_OK);
+}
+
+/* Runs one sampling round to completion, returns the delays the bus asked for */
+static std::vector<int64_t> run_round(temp_bus *bus, mock_bus *m, int64_t *now_us)
+{
+	std::vector<int64_t> delays;
+	m->round++;
+	int64_t delay = temp_bus_start_round(bus, *now_us);
+	while (delay != TEMP_BUS_DONE) {
+		delays.push_back(delay);
+		*now_us += delay;
+		delay = temp_bus_step(bus, *now_us);
+	}
+	CHECK(!temp_bus_busy(bus));
+	*now_us += 30 * 1000 * 1000;
+	return delays;
+}
+
+static bool contains(const std::vector<int64_t> &v, int64_t x)
+{
+	for (int64_t y : v) {
+		if (y == x) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void test_crc_retries_and_backoff(void)
+{
+	temp_bus bus;
+	mock_bus m = {};
+	mock_add(&m, ADDR_A)->read_err = ESP_ERR_INVALID_CRC;
+	setup(&bus, &m);
+	int64_t now_us = 0;
+
+	std::vector<int64_t> delays = run_round(&bus, &m, &now_us);
+	const temp_probe_counters *c = &bus.probes[0].counters;
+	CHECK(mock_find(&m, ADDR_A)->reads == TEMP_BUS_MAX_ATTEMPTS);
+	CHECK(c->crc_errors == TEMP_BUS_MAX_ATTEMPTS);
+	CHECK(c->retries == TEMP_BUS_MAX_ATTEMPTS - 1);
+	CHECK(c->failed_readings == 1);
+	CHECK(c->readings == 0);
+	/* exponential backoff: 20 ms, then 40 ms */
+	CHECK(contains(delays, TEMP_BUS_BACKOFF_US));
+	CHECK(contains(delays, 2 * TEMP_BUS_BACKOFF_US));
+	CHECK(!contains(delays, 4 * TEMP_BUS_BACKOFF_US));
+	CHECK(bus.probes[0].health == TEMP_PROBE_OK);
+
+	/* a good reading clears the failure streak */
+	mock_find(&m, ADDR_A)->read_err = ESP_OK;
+	run_round(&bus, &m, &now_us);
+	CHECK(c->readings == 1);
+	CHECK(bus.probes[0].consecutive_failures == 0);
+	CHECK(bus.probes[0].last == 2150);
+}
+
+static void test_timeout_and_no_presence(void)
+{
+	temp_bus bus;
+	mock_bus m = {};
+	mock_add(&m, ADDR_A)->never_done = true;
+	mock_add(&m, ADDR_B)->start_err = ESP_ERR_NOT_FOUND;
+	setup(&bus, &m);
+	int64_t now_us = 0;
+
+	run_round(&bus, &m, &now_us);
+	CHECK(bus.probes[0].counters.timeouts == TEMP_BUS_MAX_ATTEMPTS);
+	CHECK(bus.probes[0].counters.failed_readings == 1);
+	CHECK(mock_find(&m, ADDR_A)->reads == 0);
+	CHECK(bus.probes[1].counters.no_presence == TEMP_BUS_MAX_ATTEMPTS);
+	CHECK(bus.probes[1].counters.failed_readings == 1);
+	CHECK(mock_find(&m, ADDR_B)->starts == TEMP_BUS_MAX_ATTEMPTS);
+}
+
+static void test_unhealthy_probation_and_degraded_rescan(void)
+{
+	temp_bus bus;
+	mock_bus m = {};
+	mock_add(&m, ADDR_A);
+	mock_add(&m, ADDR_B)->read_err = ESP_ERR_INVALID_CRC;
+	setup(&bus, &m);
+	int64_t now_us = 0;
+
+	for (int i = 1; i < TEMP_BUS_UNHEALTHY_AFTER; i++) {
+		run_round(&bus, &m, &now_us);
+		CHECK(bus.probes[1].health == TEMP_PROBE_OK);
+	}
+	run_round(&bus, &m, &now_us);
+	CHECK(bus.probes[1].health == TEMP_PROBE_UNHEALTHY);
+	CHECK(m.health.size() == 1 && m.health[0].slot == 1 && m.health[0].health == TEMP_PROBE_UNHEALTHY);
+	CHECK(bus.probes[0].health == TEMP_PROBE_OK);
+
+	/* out of rotation until the next rescan */
+	int starts = mock_find(&m, ADDR_B)->starts;
+	run_round(&bus, &m, &now_us);
+	CHECK(mock_find(&m, ADDR_B)->starts == starts);
+	CHECK(bus.probes[0].counters.readings == (uint32_t)m.round);
+
+	/* degraded: the rescan comes after 4 rounds, and puts the probe on probation where a single failed
+	 * reading takes it out again */
+	run_round(&bus, &m, &now_us);
+	CHECK(m.search_rounds.back() == TEMP_BUS_RESCAN_ROUNDS_DEGRADED + 1);
+	CHECK(mock_find(&m, ADDR_B)->starts > starts);
+	CHECK(m.health.size() == 3 && m.health[1].health == TEMP_PROBE_OK &&
+	      m.health[2].health == TEMP_PROBE_UNHEALTHY);
+	CHECK(bus.probes[1].counters.failed_readings == TEMP_BUS_UNHEALTHY_AFTER + 1);
+
+	while (m.round < 18) {
+		run_round(&bus, &m, &now_us);
+	}
+	std::vector<int> expected = {0, 5, 9, 13, 17};
+	CHECK(m.search_rounds == expected);
+
+	/* once it reads again, it stays in rotation */
+	mock_find(&m, ADDR_B)->read_err = ESP_OK;
+	while (m.round < 22) {
+		run_round(&bus, &m, &now_us);
+	}
+	CHECK(bus.probes[1].health == TEMP_PROBE_OK);
+	CHECK(bus.probes[1].consecutive_failures == 0);
+}
+
+static void test_healthy_rescan_interval(void)
+{
+	temp_bus bus;
+	mock_bus m = {};
+	mock_add(&m, ADDR_A);
+	mock_add(&m, ADDR_B);
+	setup(&bus, &m);
+	int64_t now_us = 0;
+
+	while (m.round < 45) {
+		run_round(&bus, &m, &now_us);
+	}
+	std::vector<int> expected = {0, TEMP_BUS_RESCAN_ROUNDS + 1, 2 * TEMP_BUS_RESCAN_ROUNDS + 1};
+	CHECK(m.search_rounds == expected);
+	CHECK(m.health.empty());
+	CHECK(bus.probes[0].counters.readings == 45);
+	CHECK(bus.probes[1].counters.readings == 45);
+}
+
+static void test_missing_swap_and_add(void)
+{
+	temp_bus bus;
+	mock_bus m = {};
+	mock_add(&m, ADDR_A);
+	mock_add(&m, ADDR_B);
+	setup(&bus, &m);
+	int64_t now_us = 0;
+	run_round(&bus, &m, &now_us);
+	CHECK(bus.nr_probes == 2);
+
+	/* B unplugged */
+	mock_set_present(&m, ADDR_B, false);
+	CHECK(temp_bus_rescan(&bus) == ESP_OK);
+	CHECK(bus.probes[1].health == TEMP_PROBE_MISSING);
+	CHECK(bus.probes[1].counters.lost == 1);
+	CHECK(temp_bus_rescan(&bus) == ESP_OK);
+	CHECK(bus.probes[1].counters.lost == 1);
+	int reads = mock_find(&m, ADDR_B)->reads;
+	run_round(&bus, &m, &now_us);
+	CHECK(mock_find(&m, ADDR_B)->reads == reads);
+
+	/* C plugged in on the same cable run: it takes over B's slot and history */
+	mock_add(&m, ADDR_C);
+	CHECK(temp_bus_rescan(&bus) == ESP_OK);
+	CHECK(bus.nr_probes == 2);
+	CHECK(m.attach_slots.back() == 1);
+	CHECK(bus.probes[1].address == ADDR_C);
+	CHECK(bus.probes[1].health == TEMP_PROBE_OK);
+	CHECK(bus.probes[1].counters.lost == 1);
+	CHECK(bus.probes[1].counters.readings == 1);
+	CHECK(m.health.size() == 2 && m.health[0].health == TEMP_PROBE_MISSING && m.health[1].health == TEMP_PROBE_OK);
+	run_round(&bus, &m, &now_us);
+	CHECK(mock_find(&m, ADDR_C)->reads == 1);
+	CHECK(bus.probes[1].counters.readings == 2);
+
+	/* D added with no missing slot to reuse */
+	mock_add(&m, ADDR_D);
+	CHECK(temp_bus_rescan(&bus) == ESP_OK);
+	CHECK(bus.nr_probes == 3);
+	CHECK(bus.probes[2].address == ADDR_D);
+	CHECK(bus.probes[2].counters.readings == 0);
+
+	/* B comes back: no free slot is missing, so it gets a new one */
+	mock_set_present(&m, ADDR_B, true);
+	CHECK(temp_bus_rescan(&bus) == ESP_OK);
+	CHECK(bus.nr_probes == 4);
+	CHECK(bus.probes[3].address == ADDR_B);
+}
+
+static void test_probe_policy(void)
+{
+	static const temp_policy fine = {
+	    .deadband = 20,
+	    .guard = 100,
+	};
+	temp_bus bus;
+	mock_bus m = {};
+	mock_add(&m, ADDR_A);
+	mock_add(&m, ADDR_B);
+	temp_bus_init(&bus, &s_mock_ops, &m, &s_policy);
+	CHECK(temp_bus_set_probe_policy(&bus, ADDR_B, &fine) == ESP_OK);
+	CHECK(temp_bus_rescan(&bus) == ESP_OK);
+	CHECK(bus.probes[0].policy.deadband == s_policy.deadband);
+	CHECK(bus.probes[1].policy.deadband == fine.deadband);
+	CHECK(bus.probes[0].resolution == TEMP_RES_10B);
+	CHECK(bus.probes[1].resolution == TEMP_RES_12B);
+
+	/* set on an attached probe it applies right away, and the slot keeps it only while B lives there */
+	CHECK(temp_bus_set_probe_policy(&bus, ADDR_A, &fine) == ESP_OK);
+	CHECK(bus.probes[0].policy.deadband == fine.deadband);
+	mock_set_present(&m, ADDR_B, false);
+	mock_add(&m, ADDR_C);
+	CHECK(temp_bus_rescan(&bus) == ESP_OK);
+	CHECK(bus.probes[1].address == ADDR_C);
+	CHECK(bus.probes[1].policy.deadband == s_policy.deadband);
+
+	/* one entry per address, the table holds TEMP_BUS_MAX_PROBES of them */
+	CHECK(temp_bus_set_probe_policy(&bus, ADDR_A, &s_policy) == ESP_OK);
+	CHECK(bus.nr_probe_policies == 2);
+	CHECK(temp_bus_set_probe_policy(&bus, ADDR_C, &fine) == ESP_OK);
+	CHECK(temp_bus_set_probe_policy(&bus, ADDR_D, &fine) == ESP_OK);
+	CHECK(temp_bus_set_probe_policy(&bus, 0x0000000000000e28ULL, &fine) == ESP_ERR_NO_MEM);
+}
+
+int main(void)
+{
+	test_crc_retries_and_backoff();
+	test_timeout_and_no_presence();
+	test_unhealthy_probation_and_degraded_rescan();
+	test_healthy_rescan_interval();
+	test_missing_swap_and_add();
+	test_probe_policy();
+	return test_result("temp_bus");
+}
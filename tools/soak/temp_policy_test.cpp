@@ -0,0 +1,83 @@
+/* Host test for the resolution policy and the learned conversion times (main/temp_policy.cpp) */
+
+#include "temp_policy.h"
+#include "test_check.h"
+
+static void test_pick_by_deadband(void)
+{
+	/* two LSBs per deadband: 0.5, 0.25, 0.125 degree steps need 1, 0.5 and 0.25 degree deadbands */
+	temp_policy policy = {};
+	policy.deadband = 100;
+	CHECK(temp_policy_pick(&policy, false, 0) == TEMP_RES_9B);
+	policy.deadband = 99;
+	CHECK(temp_policy_pick(&policy, false, 0) == TEMP_RES_10B);
+	policy.deadband = 50;
+	CHECK(temp_policy_pick(&policy, false, 0) == TEMP_RES_10B);
+	policy.deadband = 49;
+	CHECK(temp_policy_pick(&policy, false, 0) == TEMP_RES_11B);
+	policy.deadband = 25;
+	CHECK(temp_policy_pick(&policy, false, 0) == TEMP_RES_11B);
+	policy.deadband = 24;
+	CHECK(temp_policy_pick(&policy, false, 0) == TEMP_RES_12B);
+	policy.deadband = 0;
+	CHECK(temp_policy_pick(&policy, false, 0) == TEMP_RES_12B);
+}
+
+static void test_pick_guard_band(void)
+{
+	temp_policy policy = {
+	    .deadband = 100,
+	    .guard = 100,
+	    .nr_thresholds = 2,
+	    .thresholds = {3500, 500},
+	};
+	/* no reading yet: the deadband decides */
+	CHECK(temp_policy_pick(&policy, false, 3500) == TEMP_RES_9B);
+	/* guard edges are inclusive, on both sides of either threshold */
+	CHECK(temp_policy_pick(&policy, true, 3400) == TEMP_RES_12B);
+	CHECK(temp_policy_pick(&policy, true, 3600) == TEMP_RES_12B);
+	CHECK(temp_policy_pick(&policy, true, 3399) == TEMP_RES_9B);
+	CHECK(temp_policy_pick(&policy, true, 3601) == TEMP_RES_9B);
+	CHECK(temp_policy_pick(&policy, true, 400) == TEMP_RES_12B);
+	CHECK(temp_policy_pick(&policy, true, 2000) == TEMP_RES_9B);
+	/* thresholds past nr_thresholds are ignored */
+	policy.nr_thresholds = 1;
+	CHECK(temp_policy_pick(&policy, true, 500) == TEMP_RES_9B);
+}
+
+static void test_conv_learn(void)
+{
+	temp_conv_stats stats;
+	temp_conv_stats_init(&stats);
+	for (int res = 0; res < TEMP_RES_COUNT; res++) {
+		CHECK(temp_conv_expected_us(&stats, (temp_resolution)res) ==
+		      temp_resolution_max_conv_us((temp_resolution)res));
+	}
+
+	/* quarter weight: 750 ms towards a 550 ms conversion is 700 ms */
+	temp_conv_learn(&stats, TEMP_RES_12B, 550000);
+	CHECK(temp_conv_expected_us(&stats, TEMP_RES_12B) == 700000);
+	CHECK(temp_conv_expected_us(&stats, TEMP_RES_11B) == 375000);
+
+	/* shrinks towards a steady measurement and stays above it */
+	for (int i = 0; i < 64; i++) {
+		temp_conv_learn(&stats, TEMP_RES_12B, 550000);
+	}
+	uint32_t settled = temp_conv_expected_us(&stats, TEMP_RES_12B);
+	CHECK(settled >= 550000 && settled < 551000);
+
+	/* a measurement past the datasheet maximum counts as the maximum, so the estimate never exceeds it */
+	for (int i = 0; i < 64; i++) {
+		temp_conv_learn(&stats, TEMP_RES_12B, 1000000);
+	}
+	CHECK(temp_conv_expected_us(&stats, TEMP_RES_12B) <= temp_resolution_max_conv_us(TEMP_RES_12B));
+	CHECK(temp_conv_expected_us(&stats, TEMP_RES_12B) > 749000);
+}
+
+int main(void)
+{
+	test_pick_by_deadband();
+	test_pick_guard_band();
+	test_conv_learn();
+	return test_result("temp_policy");
+}
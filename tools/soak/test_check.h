@@ -0,0 +1,26 @@
+#pragma once
+
+/* Minimal check macro for the host driver tests: a failed CHECK is reported and counted, the test keeps
+ * going so one run shows every broken expectation */
+
+#include <stdio.h>
+
+static int s_failures;
+
+#define CHECK(cond)                                                                              \
+	do {                                                                                     \
+		if (!(cond)) {                                                                   \
+			fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+			s_failures++;                                                            \
+		}                                                                                \
+	} while (0)
+
+static int test_result(const char *name)
+{
+	if (s_failures != 0) {
+		fprintf(stderr, "%d check(s) failed\n", s_failures);
+		return 1;
+	}
+	printf("%s: all checks passed\n", name);
+	return 0;
+}
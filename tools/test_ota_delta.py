@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Tests for ota_delta.py: python -m unittest discover -s tools -p 'test_*.py'"""
+
+import hashlib
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import ota_delta  # noqa: E402
+
+TOOL = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'ota_delta.py')
+
+
+def esp_image(body):
+    """Minimal app image: esp_image_header_t with hash_appended set, body, appended SHA-256."""
+    header = bytearray(24)
+    header[0] = ota_delta.ESP_IMAGE_MAGIC
+    header[ota_delta.ESP_IMAGE_HASH_APPENDED_OFFSET] = 1
+    image = bytes(header) + body
+    return image + hashlib.sha256(image).digest()
+
+
+def sample_images():
+    base = bytes(range(256)) * 64
+    new = bytearray(base)
+    new[1000:1016] = b'firmware v2.0.0\0'
+    new += b'new code' * 32
+    return esp_image(base), esp_image(bytes(new))
+
+
+class HeaderTest(unittest.TestCase):
+    def test_header_carries_magic_and_base_digest(self):
+        base, _ = sample_images()
+        header = ota_delta.delta_header(base, 'base')
+        self.assertEqual(len(header), ota_delta.HEADER_SIZE)
+        self.assertEqual(struct.unpack_from('<I', header)[0], ota_delta.DELTA_MAGIC)
+        self.assertEqual(header[4:4 + ota_delta.DIGEST_SIZE], hashlib.sha256(base[:-32]).digest())
+        self.assertEqual(header[4 + ota_delta.DIGEST_SIZE:], bytes(ota_delta.HEADER_SIZE - 4 - ota_delta.DIGEST_SIZE))
+
+    def test_rejects_images_without_appended_digest(self):
+        base, _ = sample_images()
+        no_hash = bytearray(base)
+        no_hash[ota_delta.ESP_IMAGE_HASH_APPENDED_OFFSET] = 0
+        with self.assertRaises(SystemExit):
+            ota_delta.delta_header(bytes(no_hash), 'base')
+        with self.assertRaises(SystemExit):
+            ota_delta.delta_header(b'\0' * 128, 'base')
+
+
+@unittest.skipIf(ota_delta.detools is None, 'detools is not installed')
+class PatchTest(unittest.TestCase):
+    def test_create_writes_header_and_applicable_patch(self):
+        base, new = sample_images()
+        with tempfile.TemporaryDirectory() as tmp:
+            paths = {name: os.path.join(tmp, name + '.bin') for name in ('base', 'new', 'patch')}
+            for name, data in (('base', base), ('new', new)):
+                with open(paths[name], 'wb') as f:
+                    f.write(data)
+            subprocess.run([sys.executable, TOOL, 'create', '--base', paths['base'], '--new', paths['new'],
+                            '--patch', paths['patch']], check=True, stdout=subprocess.DEVNULL)
+            with open(paths['patch'], 'rb') as f:
+                image = f.read()
+
+        header, patch = image[:ota_delta.HEADER_SIZE], image[ota_delta.HEADER_SIZE:]
+        self.assertEqual(header, ota_delta.delta_header(base, 'base'))
+        self.assertLess(len(image), len(new))
+        ota_delta.verify_patch(base, new, patch)
+
+
+if __name__ == '__main__':
+    unittest.main()